@@ -6,98 +6,141 @@
 #include <ctype.h>
 #include <math.h>
 #include <assert.h>
+#include <stdint.h>
 
 #include "inchi.h"
 #include "periodic.h"
 
+/*
+ * a section of the formula layer, standing for multiplier components:
+ * heavy atom i+1 of each is element[i] (in formula order); hydrogens
+ * aren't numbered
+ */
 typedef struct __formula_s {
-  int index; /* this is not the same the component index */
-  short count;
-  const element_t *element;
-  struct __formula_s *next;
+  short multiplier;
+  int nv; /* heavy atoms */
+  int nh; /* hydrogens */
+  const element_t **element; /* element[0..nv-1] */
 } formula_t;
 
+/*
+ * a section of the /h layer, standing for multiplier components: atom
+ * i+1 has count[i] Hs of its own if group[i] is 0 or shares them with
+ * the rest of mobile group group[i] > 0; group[i] < 0 if it's not listed
+ */
 typedef struct __hlayer_s {
-  int index; /* component index */
-  int atom; /* atom index */
-  short count; /* number of Hs */
-  short group; /* shared Hs if group > 1 */
-  const element_t *element;
-  struct __hlayer_s *next;
+  short multiplier;
+  int n, size; /* atoms covered and allocated */
+  short *count;
+  short *group;
 } hlayer_t;
 
-typedef struct __vertex_s {
-  int index;
-  short degree;
-  short charge;
-  
-  short hcount;
-  short hshare; /* number of shared h's (if any) for this group */
-  short hgroup; /* sharing group for h if != 0 */
+/*
+ * layers of an InChI string by their prefix (the formula has none)
+ */
+enum {
+  LAYER_FORMULA, LAYER_C, LAYER_H, LAYER_Q, LAYER_P, LAYER_B, LAYER_T,
+  LAYER_M, LAYER_S, LAYER_I, LAYERS
+};
+
+/*
+ * where the layers of an InChI string are, from one scan over it: layer
+ * k is begin[k]..end[k]-1 (both 0 if it's missing) and its components
+ * are separated by the ;s at semi[first[k]..first[k+1]-1]. only the main
+ * layers are indexed; the ones repeated by the isotopic (/i), fixed-H
+ * (/f) and reconnected (/r) layers that follow aren't
+ */
+typedef struct __layers_s {
+  const char *inchi;
+  const char *begin[LAYERS];
+  const char *end[LAYERS];
+  int first[LAYERS+1];
+  int nsemi, size;
+  const char **semi; /* semi[0..nsemi-1] */
+} layers_t;
+
+/*
+ * a section of the /c layer when they're all kept (inchi_parse_sections):
+ * vertices first..first+nv-1 of the graph, standing for multiplier
+ * components; its connection layer is at inchi_c+c
+ */
+typedef struct __section_s {
+  int first, nv;
+  short multiplier;
+  int c;
+} section_t;
 
 #define FLAG_RING    0
 #define FLAG_HETERO  1
 #define FLAG_CHIRAL  2
 #define FLAG_QUERY   4
-  unsigned flags;
-  
-  inchi_t *graph;  
-  const element_t *atom;
-  struct __edge_s **edges; /* edges[0..degree-1] */
-} vertex_t;
-
-typedef struct __edge_s {
-  int index;
-  short order;
-  vertex_t *u;
-  vertex_t *v;
-  struct __edge_s *next;
-} edge_t;
 
 typedef struct __path_s {
   int ne;
-  edge_t **edges;
+  int *edges; /* edges[0..ne-1] in order around the ring */
+  uint64_t *bits; /* bit e set for every edge e on the ring */
   struct __path_s *prev;  
   struct __path_s *next;
 } path_t;
 
 struct __inchi_s {
-  int index; /* component index */
+  int index; /* component index, counting multipliers */
   short multiplier; /* multiplicity */
   
 #ifdef __A
 # undef __A
 #endif
 #define __A(i,j) (g->A[(i)*g->size+(j)])
-  int *A; /* adjacency matrix */
-
-#ifdef __L
-# undef __L
-#endif
-#define __L(i,j) (g->L[(i)*g->size+(j)])
-  double *L; /* normalized Laplacian: use macro __L for access */
-
-#ifdef __W
-# undef __W
-#endif
-#define __W(i,j) (g->W[(i)*g->size+(j)])
-  double *W; /* weighted normalized Laplacian */
+  int *A; /* adjacency matrix; built on first request by inchi_matrix_A */
+
+  /*
+   * weighted normalized Laplacian in CSR form (0-based, the diagonal
+   * first): row i is W[Wp[i]..Wp[i+1]-1] in columns Wj[..]; built on
+   * first request by inchi_matrix_W
+   */
+  int *Wp, *Wj;
+  double *W;
   
+  /*
+   * the graph as arrays over its vertices and edges (both 0-based here;
+   * the vertex numbers in the /c layer are 1-based); one allocation,
+   * anchored at atom
+   */
   int nv; /* number of vertices */
-  vertex_t **V; /* adjacency list V[0..nv-1] */
+  const element_t **atom; /* atom[0..nv-1] */
+  short *degree;
+  short *charge;
+  short *hcount;
+  short *hshare; /* number of shared h's (if any) for this group */
+  short *hgroup; /* sharing group for h if != 0 */
+  unsigned *flags;
+  /* neighbors of u are vj[vp[u]..vp[u+1]-1] (ascending), over edges ve[..] */
+  int *vp, *vj, *ve;
+  /*
+   * and the bits set in bits[u*words..u*words+words-1] if nv is at most
+   * INCHI_BITS_MAXG (words is 0 and bits null otherwise)
+   */
+  int words;
+  uint64_t *bits;
 
   int ne; /* number of edges */
-  edge_t *E; /* linked list of edges */
+  int *eu, *ev; /* endpoints, eu[e] < ev[e] */
+  short *order;
   
-  size_t size; /* stride size for A, L, W */
+  size_t size; /* stride size for A (nv+1) */
 
-  formula_t *formula;
-  hlayer_t *hlayer;
+  int nformula;
+  formula_t *formula; /* formula[0..nformula-1] */
+  int nhlayer;
+  hlayer_t *hlayer; /* hlayer[0..nhlayer-1] */
 
   short nr;
-  path_t *R; /* rings.. R[0..nr-1] */
+  path_t *R; /* smallest set of smallest rings, linked by size */
+
+  int nsection;
+  section_t *section; /* section[0..nsection-1] */
 
-  char *inchi_c;
+  char *inchi_c; /* of every section, one after the other, if they're kept */
   size_t isize;
   
   char errmsg[BUFSIZ];
@@ -111,10 +154,13 @@ struct __inchi_s {
 # define MAX(a,b) ((a)>(b)?(a):(b))
 #endif
 
-extern vertex_t *_inchi_edge_other (const edge_t *e, const vertex_t *v);
-extern void bond_energy_length (const edge_t *e, double *d, double *r);
+extern int _inchi_edge_other (const inchi_t *g, int e, int u);
+extern int _inchi_vertex_edge (const inchi_t *g, int u, int v);
+extern void bond_energy_length (const inchi_t *g, int e, double *d, double *r);
+extern double bond_weight (const inchi_t *g, int e);
 extern int _inchi_ring_perception (inchi_t *g);
-extern void _inchi_vertex_set (vertex_t *v, unsigned flag);
-extern int _inchi_vertex_get (const vertex_t *v, unsigned flag);
+extern int _inchi_kekulize (inchi_t *g);
+extern void _inchi_vertex_set (inchi_t *g, int u, unsigned flag);
+extern int _inchi_vertex_get (const inchi_t *g, int u, unsigned flag);
 
 #endif /* !__inchi_private_h__ */
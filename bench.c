@@ -0,0 +1,305 @@
+/**
+ * Corpus harness for libspectral.a; runs spectral_digest over one or
+ * more InChI files (e.g., examples.txt and the .txt files in tests),
+ * optionally replicated to a larger size, and reports throughput, peak
+ * memory and any hashkey that differs from a golden file. The input is
+ * InChI only: there's no molfile reader, so the .mol/.sdf cases in tests
+ * are covered through the InChIs recorded alongside them (the .txt file
+ * of the same name).
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include "spectral.h"
+
+typedef struct __record_s {
+  char *inchi;
+  char *golden; /* expected hashkey; "-" if it's expected to fail */
+} record_t;
+
+typedef struct __corpus_s {
+  int size;
+  int bsize;
+  record_t *records;
+} corpus_t;
+
+static void
+corpus_add (corpus_t *corpus, const char *inchi, size_t len)
+{
+  record_t *r;
+  if (corpus->size == corpus->bsize)
+    {
+      corpus->bsize = corpus->bsize > 0 ? 2*corpus->bsize : 1024;
+      corpus->records = realloc (corpus->records,
+                                 corpus->bsize*sizeof (record_t));
+    }
+  r = &corpus->records[corpus->size++];
+  r->inchi = malloc (len+1);
+  (void) strncpy (r->inchi, inchi, len);
+  r->inchi[len] = '\0';
+  r->golden = 0;
+}
+
+/*
+ * only lines that start with InChI= are used; everything else (e.g.,
+ * AuxInfo in tests/test15.sdf.txt) is skipped, and a file without any
+ * (such as a molfile) is a warning
+ */
+static int
+corpus_load (corpus_t *corpus, const char *file)
+{
+  char buffer[1<<15];
+  int size = corpus->size;
+  FILE *fp = fopen (file, "r");
+  if (fp == 0)
+    {
+      fprintf (stderr, "** error: can't open file '%s' for reading! **\n",
+               file);
+      return -1;
+    }
+
+  while (fgets (buffer, sizeof (buffer), fp) != 0)
+    {
+      char *tok = buffer;
+      if (strncmp ("InChI=", buffer, 6) != 0)
+        continue;
+
+      while (*tok != '\0' && !isspace (*tok))
+        ++tok;
+      corpus_add (corpus, buffer, tok - buffer);
+    }
+  (void) fclose (fp);
+
+  if (corpus->size == size)
+    fprintf (stderr, "** warning: no InChI in '%s'; molfiles aren't read, "
+             "use the InChIs recorded for them **\n", file);
+
+  return 0;
+}
+
+static int
+corpus_golden (corpus_t *corpus, const char *file)
+{
+  char buffer[1<<15];
+  int i = 0;
+  FILE *fp = fopen (file, "r");
+  if (fp == 0)
+    {
+      fprintf (stderr, "** error: can't open golden file '%s'! **\n", file);
+      return -1;
+    }
+
+  /* golden file is hashkey<TAB>inchi in the same order as the corpus */
+  while (fgets (buffer, sizeof (buffer), fp) != 0 && i < corpus->size)
+    {
+      char *inchi = strchr (buffer, '\t'), *end;
+      if (inchi == 0)
+        continue;
+      *inchi++ = '\0';
+      for (end = inchi; *end != '\0' && !isspace (*end); ++end)
+        ;
+      *end = '\0';
+
+      if (strcmp (inchi, corpus->records[i].inchi) != 0)
+        {
+          fprintf (stderr, "** error: golden file '%s' is out of sync with "
+                   "corpus at record %d (%s)! **\n", file, i+1, inchi);
+          (void) fclose (fp);
+          return -1;
+        }
+      corpus->records[i++].golden = strdup (buffer);
+    }
+  (void) fclose (fp);
+
+  if (i < corpus->size)
+    fprintf (stderr, "** warning: golden file '%s' covers only %d of %d "
+             "records **\n", file, i, corpus->size);
+
+  return 0;
+}
+
+static void
+corpus_free (corpus_t *corpus)
+{
+  int i;
+  for (i = 0; i < corpus->size; ++i)
+    {
+      free (corpus->records[i].inchi);
+      if (corpus->records[i].golden != 0)
+        free (corpus->records[i].golden);
+    }
+  if (corpus->records != 0)
+    free (corpus->records);
+}
+
+static double
+elapsed (const struct timespec *t0)
+{
+  struct timespec t1;
+  (void) clock_gettime (CLOCK_MONOTONIC, &t1);
+  return (t1.tv_sec - t0->tv_sec) + (t1.tv_nsec - t0->tv_nsec)*1e-9;
+}
+
+static double
+peak_rss ()
+{
+  struct rusage ru;
+  (void) getrusage (RUSAGE_SELF, &ru);
+#ifdef __APPLE__
+  return ru.ru_maxrss / (1024.*1024.); /* bytes */
+#else
+  return ru.ru_maxrss / 1024.; /* kilobytes */
+#endif
+}
+
+/*
+ * run the corpus through the current solver setting of spectral and
+ * report; returns the number of mismatches against the golden keys
+ */
+static int
+bench (spectral_t *spectral, const char *solver, const corpus_t *corpus,
+       int replicate, int fiedler, int golden, FILE *outfp)
+{
+  int i, r, errors = 0, diffs = 0, missing = 0;
+  struct timespec t0;
+  double secs;
+
+  (void) clock_gettime (CLOCK_MONOTONIC, &t0);
+  for (r = 0; r < replicate; ++r)
+    for (i = 0; i < corpus->size; ++i)
+      {
+        const record_t *rec = &corpus->records[i];
+        const char *hk = spectral_digest (spectral, rec->inchi);
+
+        if (hk == 0)
+          ++errors;
+        else if (fiedler)
+          (void) spectral_fiedler (spectral);
+
+        if (r > 0)
+          continue;
+
+        if (outfp != 0)
+          fprintf (outfp, "%s\t%s\n", hk != 0 ? hk : "-", rec->inchi);
+
+        if (rec->golden == 0)
+          ++missing;
+        else if (strcmp (rec->golden, hk != 0 ? hk : "-") != 0)
+          {
+            fprintf (stderr, "** %s mismatch: %s expected %s got %s **\n",
+                     solver, rec->inchi, rec->golden, hk != 0 ? hk : "-");
+            ++diffs;
+          }
+      }
+  secs = elapsed (&t0);
+
+  printf ("solver: %s\n", solver);
+  printf ("  records: %d x %d = %d in %.3fs (%.1f records/sec, %d errors)\n",
+          corpus->size, replicate, corpus->size*replicate, secs,
+          corpus->size*replicate / (secs > 0. ? secs : 1e-9), errors);
+  printf ("  peak RSS: %.1f MB\n", peak_rss ());
+  if (golden)
+    printf ("  golden: %d checked, %d mismatch(es), %d missing\n",
+            corpus->size - missing, diffs, missing);
+
+  return diffs;
+}
+
+static void
+usage (const char *prog)
+{
+  fprintf (stderr,
+           "usage: %s [-r N] [-g golden] [-o golden] [-b solver] [-f] FILE...\n"
+           "  FILE       InChI strings, one per line (other lines are skipped;\n"
+           "             molfiles aren't read)\n"
+           "  -r N       replicate the corpus N times (default 1)\n"
+           "  -g golden  check hashkeys against the golden file\n"
+           "  -o golden  write the hashkeys of the corpus to golden\n"
+           "  -b solver  force the eigensolver; 'all' runs each compiled-in\n"
+           "             solver in turn (default is the size based policy)\n"
+           "  -f         also fetch the fiedler vector for each record\n",
+           prog);
+}
+
+int
+main (int argc, char *argv[])
+{
+  corpus_t corpus = {0};
+  spectral_t *spectral;
+  const char *golden = 0, *output = 0, *solver = "auto";
+  int i, c, replicate = 1, fiedler = 0, diffs = 0;
+  FILE *outfp = 0;
+
+  while ((c = getopt (argc, argv, "r:g:o:b:fh")) != -1)
+    switch (c)
+      {
+      case 'r': replicate = atoi (optarg); break;
+      case 'g': golden = optarg; break;
+      case 'o': output = optarg; break;
+      case 'b': solver = optarg; break;
+      case 'f': fiedler = 1; break;
+      default:
+        usage (argv[0]);
+        return 1;
+      }
+
+  if (optind == argc || replicate < 1)
+    {
+      usage (argv[0]);
+      return 1;
+    }
+
+  for (i = optind; i < argc; ++i)
+    if (corpus_load (&corpus, argv[i]) < 0)
+      return 1;
+
+  if (golden != 0 && corpus_golden (&corpus, golden) < 0)
+    return 1;
+
+  if (output != 0)
+    {
+      outfp = fopen (output, "w");
+      if (outfp == 0)
+        {
+          fprintf (stderr, "** error: can't open file '%s' for writing! **\n",
+                   output);
+          return 1;
+        }
+    }
+
+  spectral = spectral_create ();
+  fprintf (stderr, "## bench -- %s\n", spectral_version ());
+  printf ("backend: %s\n", spectral_version ());
+
+  if (strcmp (solver, "all") == 0)
+    {
+      const char *name;
+      for (i = 0; (name = spectral_solver_name (i)) != 0; ++i)
+        {
+          (void) spectral_set_solver (spectral, name);
+          diffs += bench (spectral, name, &corpus, replicate,
+                          fiedler, golden != 0, i == 0 ? outfp : 0);
+        }
+    }
+  else if (spectral_set_solver (spectral, solver) == 0)
+    diffs = bench (spectral, solver, &corpus, replicate,
+                   fiedler, golden != 0, outfp);
+  else
+    {
+      fprintf (stderr, "** error: %s **\n", spectral_error (spectral));
+      diffs = -1;
+    }
+
+  if (outfp != 0)
+    (void) fclose (outfp);
+  spectral_free (spectral);
+  corpus_free (&corpus);
+
+  return diffs != 0 ? 2 : 0;
+}
@@ -0,0 +1,538 @@
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "cpoly.h"
+
+typedef unsigned long long u64;
+typedef unsigned __int128 u128;
+
+/*
+ * primes are taken in decreasing order from here; every one of them is
+ * above 2^60, so k primes cover (at least) 60k bits
+ */
+#define CPOLY_PRIME_MAX ((1ull << 61) - 1)
+#define CPOLY_PRIME_BITS 60
+
+/* inverses of degrees up to this are computed once per prime */
+#define CPOLY_DEGREE_MAX 8
+
+struct __cpoly_s {
+  int nprimes; /* primes found so far */
+  int psize; /* allocated primes */
+  u64 *primes;
+  int bsize; /* allocated order */
+  int ksize; /* allocated primes per coefficient */
+  u64 *h; /* n x n matrix being reduced to hessenberg form */
+  u64 *poly; /* charpolys of its leading minors; k+1 coefficients each */
+  u64 *res; /* (n+1) x k residues of the coefficients */
+  u64 *x, *y, *P; /* multiprecision scratch of ksize+1 limbs */
+  u64 *cinv; /* 1/(p_0 .. p_{c-1}) mod p_c for garner */
+  unsigned char *bytes; /* see cpoly_bytes */
+  size_t nbytes, bytesize;
+};
+
+/*
+ * arithmetic modulo an odd p < 2^62 in montgomery form, i.e., a is kept
+ * as aR mod p with R = 2^64
+ */
+typedef struct __modp_s {
+  u64 p;
+  u64 pinv; /* -1/p mod R */
+  u64 r2; /* R^2 mod p */
+  u64 one; /* R mod p */
+} modp_t;
+
+static inline u64
+redc (const modp_t *m, u128 t)
+{
+  u64 q = (u64)t * m->pinv;
+  u64 r = (t + (u128)q * m->p) >> 64;
+  return r >= m->p ? r - m->p : r;
+}
+
+static inline u64
+mul (const modp_t *m, u64 a, u64 b)
+{
+  return redc (m, (u128)a * b);
+}
+
+static inline u64
+add (const modp_t *m, u64 a, u64 b)
+{
+  a += b;
+  return a >= m->p ? a - m->p : a;
+}
+
+static inline u64
+sub (const modp_t *m, u64 a, u64 b)
+{
+  return a >= b ? a - b : a + m->p - b;
+}
+
+static void
+modp_init (modp_t *m, u64 p)
+{
+  u64 inv = p;
+  int i;
+  for (i = 0; i < 5; ++i) /* newton; each step doubles the correct bits */
+    inv *= 2 - p*inv;
+  m->p = p;
+  m->pinv = -inv;
+  m->one = (u64)(((u128)1 << 64) % p);
+  m->r2 = (u64)((u128)m->one * m->one % p);
+}
+
+static inline u64
+to_mont (const modp_t *m, u64 a)
+{
+  return mul (m, a, m->r2);
+}
+
+static inline u64
+from_mont (const modp_t *m, u64 a)
+{
+  return redc (m, a);
+}
+
+static u64
+inverse (const modp_t *m, u64 a)
+{
+  u64 r = m->one, e = m->p - 2;
+  for (; e > 0; e >>= 1)
+    {
+      if (e & 1)
+        r = mul (m, r, a);
+      a = mul (m, a, a);
+    }
+  return r;
+}
+
+/* plain (a * b) mod p, for the setup and crt */
+static inline u64
+mulmod (u64 a, u64 b, u64 p)
+{
+  return (u64)((u128)a * b % p);
+}
+
+static u64
+powmod (u64 a, u64 e, u64 p)
+{
+  u64 r = 1;
+  for (; e > 0; e >>= 1)
+    {
+      if (e & 1)
+        r = mulmod (r, a, p);
+      a = mulmod (a, a, p);
+    }
+  return r;
+}
+
+/* deterministic miller-rabin for 64-bit n */
+static int
+is_prime (u64 n)
+{
+  static const u64 bases[] = {2, 325, 9375, 28178, 450775, 9780504,
+                              1795265022};
+  u64 d = n - 1, x;
+  int i, r, s = 0;
+
+  if (n < 2 || (n & 1) == 0)
+    return n == 2;
+  for (; (d & 1) == 0; d >>= 1)
+    ++s;
+
+  for (i = 0; i < sizeof (bases)/sizeof (bases[0]); ++i)
+    {
+      if (bases[i] % n == 0)
+        continue;
+      x = powmod (bases[i] % n, d, n);
+      if (x == 1 || x == n-1)
+        continue;
+      for (r = 1; r < s; ++r)
+        if ((x = mulmod (x, x, n)) == n-1)
+          break;
+      if (r == s)
+        return 0;
+    }
+  return 1;
+}
+
+static int
+cpoly_primes (cpoly_t *cp, int k)
+{
+  u64 q;
+  if (k > cp->psize)
+    {
+      u64 *primes = realloc (cp->primes, k*sizeof (u64));
+      if (primes == 0)
+        return -1;
+      cp->primes = primes;
+      cp->psize = k;
+    }
+  for (q = cp->nprimes > 0 ? cp->primes[cp->nprimes-1] - 2
+         : CPOLY_PRIME_MAX; cp->nprimes < k; q -= 2)
+    if (is_prime (q))
+      cp->primes[cp->nprimes++] = q;
+  return 0;
+}
+
+cpoly_t *
+cpoly_create ()
+{
+  cpoly_t *cp = malloc (sizeof (cpoly_t));
+  if (cp != 0)
+    (void) memset (cp, 0, sizeof (*cp));
+  return cp;
+}
+
+void
+cpoly_free (cpoly_t *cp)
+{
+  if (cp != 0)
+    {
+      if (cp->primes != 0)
+        free (cp->primes);
+      if (cp->h != 0)
+        free (cp->h);
+      if (cp->poly != 0)
+        free (cp->poly);
+      if (cp->res != 0)
+        free (cp->res);
+      if (cp->x != 0)
+        free (cp->x);
+      if (cp->bytes != 0)
+        free (cp->bytes);
+      free (cp);
+    }
+}
+
+static int
+cpoly_reserve (cpoly_t *cp, int n, int k)
+{
+  if (cp->bsize < n)
+    {
+      free (cp->h);
+      free (cp->poly);
+      cp->h = malloc ((size_t)n*n*sizeof (u64));
+      cp->poly = malloc ((size_t)(n+1)*(n+2)/2*sizeof (u64));
+      if (cp->h == 0 || cp->poly == 0)
+        {
+          cp->bsize = 0;
+          return -1;
+        }
+      cp->bsize = n;
+      cp->ksize = 0; /* res depends on n too */
+    }
+  if (cp->ksize < k)
+    {
+      free (cp->res);
+      free (cp->x);
+      cp->res = malloc ((size_t)(cp->bsize+1)*k*sizeof (u64));
+      cp->x = malloc (4*(k+1)*sizeof (u64));
+      if (cp->res == 0 || cp->x == 0)
+        {
+          cp->ksize = 0;
+          return -1;
+        }
+      cp->y = cp->x + k+1;
+      cp->P = cp->y + k+1;
+      cp->cinv = cp->P + k+1;
+      cp->ksize = k;
+    }
+  return 0;
+}
+
+/*
+ * charpoly of I - D^{-1}A (in h) modulo m: reduction to hessenberg form
+ * by elementary similarity transforms, then the recurrence over its
+ * leading principal minors (cohen, algorithm 2.2.9). the minor of order
+ * k has k+1 coefficients, so they're packed as a triangle with p_k at
+ * poly + k*(k+1)/2; the n+1 coefficients (x^0 first) of the last one
+ * end up in poly + n*(n+1)/2.
+ */
+static void
+cpoly_modp (cpoly_t *cp, const modp_t *m, int n)
+{
+  u64 *H = cp->h, *poly = cp->poly, u, t, v;
+  int i, j, k;
+
+#define __h(i,j) H[(size_t)(i)*n+(j)]
+  for (k = 1; k < n-1; ++k)
+    {
+      for (i = k; i < n && __h (i, k-1) == 0; ++i)
+        ;
+      if (i == n)
+        continue;
+      if (i != k)
+        {
+          for (j = k-1; j < n; ++j)
+            {
+              t = __h (i, j);
+              __h (i, j) = __h (k, j);
+              __h (k, j) = t;
+            }
+          for (j = 0; j < n; ++j)
+            {
+              t = __h (j, i);
+              __h (j, i) = __h (j, k);
+              __h (j, k) = t;
+            }
+        }
+
+      v = inverse (m, __h (k, k-1));
+      for (i = k+1; i < n; ++i)
+        if (__h (i, k-1) != 0)
+          {
+            /* the graph is sparse, and stays so for a while */
+            u = mul (m, __h (i, k-1), v);
+            for (j = k-1; j < n; ++j)
+              if (__h (k, j) != 0)
+                __h (i, j) = sub (m, __h (i, j), mul (m, u, __h (k, j)));
+            for (j = 0; j < n; ++j)
+              if (__h (j, i) != 0)
+                __h (j, k) = add (m, __h (j, k), mul (m, u, __h (j, i)));
+          }
+    }
+
+#define __p(r,c) poly[(size_t)(r)*((r)+1)/2+(c)]
+  __p (0, 0) = m->one;
+  for (k = 1; k <= n; ++k)
+    {
+      /* (x - h_kk) p_{k-1} */
+      __p (k, k) = __p (k-1, k-1);
+      for (i = k-1; i > 0; --i)
+        __p (k, i) = sub (m, __p (k-1, i-1),
+                          mul (m, __h (k-1, k-1), __p (k-1, i)));
+      __p (k, 0) = sub (m, 0, mul (m, __h (k-1, k-1), __p (k-1, 0)));
+
+      for (i = 1, t = m->one; i < k; ++i)
+        {
+          t = mul (m, t, __h (k-i, k-i-1));
+          if (t == 0)
+            break;
+          u = mul (m, t, __h (k-i-1, k-1));
+          for (j = 0; j <= k-i-1; ++j)
+            __p (k, j) = sub (m, __p (k, j), mul (m, u, __p (k-i-1, j)));
+        }
+    }
+#undef __p
+#undef __h
+}
+
+/* x := x*a + b over limbs x[0..*len-1] */
+static void
+mp_muladd (u64 *x, int *len, u64 a, u64 b)
+{
+  u128 t;
+  int i;
+  for (i = 0; i < *len; ++i)
+    {
+      t = (u128)x[i]*a + b;
+      x[i] = (u64)t;
+      b = t >> 64;
+    }
+  if (b != 0)
+    x[(*len)++] = b;
+}
+
+static int
+mp_cmp (const u64 *x, int xlen, const u64 *y, int ylen)
+{
+  while (xlen > 0 && x[xlen-1] == 0)
+    --xlen;
+  while (ylen > 0 && y[ylen-1] == 0)
+    --ylen;
+  if (xlen != ylen)
+    return xlen < ylen ? -1 : 1;
+  while (--xlen >= 0)
+    if (x[xlen] != y[xlen])
+      return x[xlen] < y[xlen] ? -1 : 1;
+  return 0;
+}
+
+/* y := P - x for x <= P */
+static void
+mp_sub (u64 *y, const u64 *P, int plen, const u64 *x, int xlen)
+{
+  u64 borrow = 0, xi;
+  int i;
+  for (i = 0; i < plen; ++i)
+    {
+      xi = i < xlen ? x[i] : 0;
+      y[i] = P[i] - xi - borrow;
+      borrow = P[i] < xi || (P[i] == xi && borrow) ? 1 : 0;
+    }
+}
+
+static int
+cpoly_append (cpoly_t *cp, int negative, const u64 *x, int len)
+{
+  int i, size;
+
+  while (len > 0 && x[len-1] == 0)
+    --len;
+  size = 8*len;
+  while (size > 0 && ((x[(size-1)/8] >> 8*((size-1)%8)) & 0xff) == 0)
+    --size;
+
+  if (cp->nbytes + 3 + size > cp->bytesize)
+    {
+      size_t bytesize = 2*(cp->nbytes + 3 + size);
+      unsigned char *bytes = realloc (cp->bytes, bytesize);
+      if (bytes == 0)
+        return -1;
+      cp->bytes = bytes;
+      cp->bytesize = bytesize;
+    }
+
+  cp->bytes[cp->nbytes++] = negative;
+  cp->bytes[cp->nbytes++] = size & 0xff;
+  cp->bytes[cp->nbytes++] = (size >> 8) & 0xff;
+  for (i = 0; i < size; ++i)
+    cp->bytes[cp->nbytes++] = (x[i/8] >> 8*(i%8)) & 0xff;
+  return 0;
+}
+
+int
+cpoly_graph (cpoly_t *cp, int n, const int *p, const int *j)
+{
+  double bits = 1.;
+  int i, c, q, k, len, plen;
+  u64 *v, s;
+
+  /*
+   * |coefficient| <= max |det(xD - L)| on |x| = 1 <= prod of the 2-norms
+   * of its rows (hadamard), i.e., of |x-1| d_i <= 2 d_i and d_i ones; the
+   * primes have to cover twice that for the sign
+   */
+  for (i = 0; i < n; ++i)
+    {
+      double d = p[i+1] > p[i] ? p[i+1] - p[i] : 1;
+      bits += .5*log2 (4.*d*d + d);
+    }
+  k = (int)(bits / CPOLY_PRIME_BITS) + 1;
+
+  if (cpoly_primes (cp, k) < 0 || cpoly_reserve (cp, n, k) < 0)
+    return -1;
+
+  for (c = 0; c < k; ++c)
+    {
+      modp_t m;
+      u64 det = 1, inv[CPOLY_DEGREE_MAX+1] = {0};
+
+      modp_init (&m, cp->primes[c]);
+      (void) memset (cp->h, 0, (size_t)n*n*sizeof (u64));
+      for (i = 0; i < n; ++i)
+        {
+          int d = p[i+1] - p[i];
+          u64 v = d <= CPOLY_DEGREE_MAX ? inv[d] : 0;
+          if (d <= 1)
+            v = m.one;
+          else if (v == 0)
+            {
+              v = inverse (&m, to_mont (&m, d));
+              if (d <= CPOLY_DEGREE_MAX)
+                inv[d] = v;
+            }
+          cp->h[(size_t)i*n+i] = m.one;
+          for (q = p[i]; q < p[i+1]; ++q)
+            cp->h[(size_t)i*n+j[q]] = sub (&m, 0, v);
+          if (d > 1)
+            det = mulmod (det, d, m.p);
+        }
+
+      cpoly_modp (cp, &m, n);
+      det = to_mont (&m, det);
+      for (i = 0; i <= n; ++i)
+        cp->res[(size_t)i*k+c] = from_mont
+          (&m, mul (&m, det, cp->poly[(size_t)n*(n+1)/2+i]));
+    }
+
+  /* P = prod of the primes */
+  cp->P[0] = 1;
+  plen = 1;
+  for (c = 0; c < k; ++c)
+    {
+      u64 pc = cp->primes[c], prod = 1;
+      for (q = 0; q < c; ++q)
+        prod = mulmod (prod, cp->primes[q] % pc, pc);
+      cp->cinv[c] = powmod (prod, pc-2, pc);
+      mp_muladd (cp->P, &plen, pc, 0);
+    }
+
+  cp->nbytes = 0;
+  for (i = 0; i <= n; ++i)
+    {
+      /* garner: the mixed radix digits of the coefficient, in place */
+      v = cp->res + (size_t)i*k;
+      for (c = 1; c < k; ++c)
+        {
+          u64 pc = cp->primes[c];
+          for (q = c-1, s = 0; q >= 0; --q)
+            s = (mulmod (s, cp->primes[q] % pc, pc) + v[q] % pc) % pc;
+          v[c] = mulmod ((v[c] + pc - s) % pc, cp->cinv[c], pc);
+        }
+
+      cp->x[0] = v[k-1];
+      len = 1;
+      for (c = k-2; c >= 0; --c)
+        mp_muladd (cp->x, &len, cp->primes[c], v[c]);
+      for (q = len; q < plen; ++q)
+        cp->x[q] = 0;
+
+      /* residues above P/2 are negative */
+      mp_sub (cp->y, cp->P, plen, cp->x, len);
+      if (mp_cmp (cp->y, plen, cp->x, len) < 0)
+        q = cpoly_append (cp, 1, cp->y, plen);
+      else
+        q = cpoly_append (cp, 0, cp->x, len);
+      if (q < 0)
+        return -1;
+    }
+
+  return k;
+}
+
+const unsigned char *
+cpoly_bytes (const cpoly_t *cp, size_t *size)
+{
+  *size = cp->nbytes;
+  return cp->bytes;
+}
+
+
+#ifdef __CPOLY_TEST
+int main ()
+{
+  /* the path P3: det(xD - L) = 2x(x-1)(x-2) = 2x^3 - 6x^2 + 4x */
+  int p[] = {0, 1, 3, 4}, j[] = {1, 0, 2, 1}, k;
+  size_t i, size;
+  const unsigned char *b;
+  cpoly_t *cp = cpoly_create ();
+
+  k = cpoly_graph (cp, 3, p, j);
+  b = cpoly_bytes (cp, &size);
+  printf ("%d prime(s):", k);
+  for (i = 0; i < size; )
+    {
+      int len = b[i+1] | b[i+2] << 8, v = 0, s;
+      for (s = len; s > 0; --s)
+        v = v << 8 | b[i+2+s];
+      printf (" %s%d", b[i] ? "-" : "", v);
+      i += 3 + len;
+    }
+  printf (" (expected: 0 4 -6 2)\n");
+  cpoly_free (cp);
+
+  return 0;
+}
+#endif
+
+/**
+ * Local Variables:
+ * compile-command: "gcc -Wall -g -o cpoly cpoly.c -D__CPOLY_TEST -lm"
+ * End:
+ */
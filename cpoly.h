@@ -0,0 +1,44 @@
+
+#ifndef __cpoly_h__
+#define __cpoly_h__
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Exact characteristic polynomial det(xD - L) of a graph, with L = D - A
+ * its laplacian and D its degrees (1 for an isolated vertex, whose row of
+ * L is then taken to be 1 too). its roots are the eigenvalues of the
+ * normalized laplacian, but the coefficients are integers: they're
+ * computed by Hessenberg reduction modulo as many 61-bit primes as a
+ * bound on their size calls for and put together by the chinese
+ * remainder theorem, so there's no floating point anywhere.
+ */
+
+typedef struct __cpoly_s cpoly_t;
+
+extern cpoly_t *cpoly_create ();
+extern void cpoly_free (cpoly_t *);
+
+/*
+ * det(xD - L) of the n vertex graph with (symmetric, loop free) adjacency
+ * lists j[p[i]..p[i+1]-1]; returns the number of primes it took or -1 on
+ * failure (out of memory).
+ */
+extern int cpoly_graph (cpoly_t *, int n, const int *p, const int *j);
+
+/*
+ * the coefficients of the last polynomial from x^0 to x^n, each as a
+ * sign byte (0 or 1 for negative), its size in bytes (2 bytes, little
+ * endian) and its magnitude in that many bytes (little endian, no
+ * leading zeros); the same polynomial always gives the same bytes.
+ */
+extern const unsigned char *cpoly_bytes (const cpoly_t *, size_t *size);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* __cpoly_h__ */
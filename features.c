@@ -3,476 +3,172 @@
 #include "_inchi.h"
 
 /*
- * these are from http://cccbdb.nist.gov/
+ * atoms with bond entries; BOND_ATOM maps an atomic number to its row
+ * of BONDS (0 for atoms without any)
  */
-void
-bond_energy_length (const edge_t *e,
-                    double *d /* energy */, double *r /* length */)
-{
-  const vertex_t *u = e->u->atom->atno < e->v->atom->atno
-    ? e->u : e->v;
-  const vertex_t *v = _inchi_edge_other (e, u);
-
-  /*
-   * d is kJ/mol
-   * r is pm
-   */
-  if (d != 0) *d = 0;
-  if (r != 0) *r = 1000;
-
-  switch (u->atom->atno)
-    {
-    case 1:
-      switch (v->atom->atno)
-        {
-        case 1: /* H-H */
-          if (d != 0) *d = 432;
-          if (r != 0) *r = 74;
-          break;
-
-        case 5: /* H-B */
-          if (d != 0) *d = 389;
-          if (r != 0) *r = 119;
-          break;
-
-        case 6: /* H-C */
-          if (d != 0) *d = 411;
-          if (r != 0) *r = 109;
-          break;
-
-        case 7: /* H-N */
-          if (d != 0) *d = 386;
-          if (r != 0) *r = 101;
-          break;
-
-        case 8: /* H-O */
-          if (d != 0) *d = 459;
-          if (r != 0) *r = 96;
-          break;
-
-        case 9: /* H-F */
-          if (d != 0) *d = 565;
-          if (r != 0) *r = 92;
-          break;
-
-        case 14: /* H-Si */
-          if (d != 0) *d = 318;
-          if (r != 0) *r = 148;
-          break;
-
-        case 15: /* H-P */
-          if (d != 0) *d = 322;
-          if (r != 0) *r = 144;
-          break;
-
-        case 16: /* H-S */
-          if (d != 0) *d = 363;
-          if (r != 0) *r = 134;
-          break;
-
-        case 17: /* H-Cl */
-          if (d != 0) *d = 428;
-          if (r != 0) *r = 127;
-          break;
-
-        case 35: /* H-Br */
-          if (d != 0) *d = 362;
-          if (r != 0) *r = 141;
-          break;
-          
-        case 53: /* H-I */
-          if (d != 0) *d = 295;
-          if (r != 0) *r = 161;
-        }
-      break;
-
-    case 5:
-      switch (v->atom->atno)
-        {
-        case 5: /* B-B */
-          if (d != 0) *d = 293;
-          if (r != 0) *r = 170.2;
-          break;
-
-        case 6: /* B-C */
-          if (d != 0) *d = 536;
-          if (r != 0) *r = 149.1;
-          break;
-
-        case 9:
-          if (d != 0) *d = 613;
-          if (r != 0) *r = 130.7;
-          break;
-
-        case 17:
-          if (d != 0) *d = 456;
-          if (r != 0) *r = 175;
-          break;
-
-        case 35:
-          if (d != 0) *d = 377;
-          if (r != 0) *r = 188.8;
-          break;
-
-        default:
-          fprintf (stderr, "** Error: No energy/length entries for %s-%s! **\n",
-                   u->atom->symbol, v->atom->symbol);
-        }
-      break;
-
-    case 6:
-      switch (v->atom->atno)
-        {
-        case 6:
-          if (e->order == 1)
-            {
-              if (d != 0) *d = 346;
-              if (r != 0) *r = 154;
-            }
-          else if (e->order == 2)
-            {
-              if (d != 0) *d = 602;
-              if (r != 0) *r = 134;
-            }
-          else if (e->order == 3)
-            {
-              if (d != 0) *d = 835;
-              if (r != 0) *r = 120;
-            }
-          else
-            fprintf (stderr, "** Error: Unknown bond order "
-                     "%d between C and C **\n", e->order);
-          break;
-
-        case 7:
-          if (e->order == 1)
-            {
-              if (d != 0) *d = 305;
-              if (r != 0) *r = 147;
-            }
-          else if (e->order == 2)
-            {
-              if (d != 0) *d = 615;
-              if (r != 0) *r = 129;
-            }
-          else if (e->order == 3)
-            {
-              if (d != 0) *d = 887;
-              if (r != 0) *r = 116;
-            }
-          else
-            fprintf (stderr, "** Error: Unknown bond order "
-                     "%d between C and N **\n", e->order);
-          break;
-
-        case 8:
-          if (e->order == 1)
-            {
-              if (d != 0) *d = 358;
-              if (r != 0) *r = 143;
-            }
-          else if (e->order == 2)
-            {
-              if (d != 0) *d = 799;
-              if (r != 0) *r = 120;
-            }
-          else if (e->order == 3)
-            {
-              if (d != 0) *d = 1072;
-              if (r != 0) *r = 113;
-            }
-          else
-            fprintf (stderr, "** Error: Unknown bond order "
-                     "%d between C and O **\n", e->order);
-          break;
-
-        case 9: /* C-F */
-          if (d != 0) *d = 485;
-          if (r != 0) *r = 135;
-          break;
-
-        case 14: /* C-Si */
-          if (d != 0) *d = 318;
-          if (r != 0) *r = 185;
-          break;
-
-        case 15: /* C-P */
-          if (d != 0) *d = 264;
-          if (r != 0) *r = 184;
-          break;
-
-        case 16: /* C-S */
-          if (e->order == 1)
-            {
-              if (d != 0) *d = 272;
-              if (r != 0) *r = 182;
-            }
-          else if (e->order == 2)
-            {
-              if (d != 0) *d = 573;
-              if (r != 0) *r = 160;
-            }
-          break;
-          
-        case 17: /* C-Cl */
-          if (d != 0) *d = 327;
-          if (r != 0) *r = 177;
-          break;
-
-        case 35: /* C-Br */
-          if (d != 0) *d = 285;
-          if (r != 0) *r = 194;
-
-        case 53: /* C-I */
-          if (d != 0) *d = 213;
-          if (r != 0) *r = 214;
-        }
-      break;
+enum {
+  BOND_NONE, BOND_H, BOND_B, BOND_C, BOND_N, BOND_O, BOND_F, BOND_Si,
+  BOND_P, BOND_S, BOND_Cl, BOND_Br, BOND_I, BOND_ATOMS
+};
 
-    case 7:
-      switch (v->atom->atno)
-        {
-        case 7: /* N*N */
-          if (e->order == 1)
-            {
-              if (d != 0) *d = 167;
-              if (r != 0) *r = 145;
-            }
-          else if (e->order == 2)
-            {
-              if (d != 0) *d = 418;
-              if (r != 0) *r = 125;
-            }
-          else if (e->order == 3)
-            {
-              if (d != 0) *d = 942;
-              if (r != 0) *r = 110;
-            }
-          break;
+#define BOND_ATNO_MAX 53
+#define BOND_ORDER_MAX 3
 
-        case 8: /* N*O */
-          if (e->order == 1)
-            {
-              if (d != 0) *d = 201;
-              if (r != 0) *r = 140;
-            }
-          else if (e->order == 2)
-            {
-              if (d != 0) *d = 607;
-              if (r != 0) *r = 121;
-            }
-          break;
+static const unsigned char BOND_ATOM[BOND_ATNO_MAX+1] = {
+  [1] = BOND_H, [5] = BOND_B, [6] = BOND_C, [7] = BOND_N, [8] = BOND_O,
+  [9] = BOND_F, [14] = BOND_Si, [15] = BOND_P, [16] = BOND_S,
+  [17] = BOND_Cl, [35] = BOND_Br, [53] = BOND_I
+};
 
-        case 9: /* N-F */
-          if (d != 0) *d = 283;
-          if (r != 0) *r = 136;
-          break;
+typedef struct __bond_s {
+  float d; /* energy in kJ/mol; 0 if unknown */
+  float r; /* length in pm; 0 if unknown */
+} bond_t;
 
-        case 14: /* N-Si */
-          if (d != 0) *d = 355;
-          if (r != 0) *r = 157.19;
-          break;
-
-        case 16: /* N=S */
-          if (r != 0) *r = 149.7;
-          break;
-          
-        case 17: /* N-Cl */
-          if (d != 0) *d = 313;
-          if (r != 0) *r = 175;
-          break;
-        }
-      break;
-
-    case 8:
-      switch (v->atom->atno)
-        {
-        case 8:
-          if (e->order == 1)
-            {
-              if (d != 0) *d = 142;
-              if (r != 0) *r = 148;
-            }
-          else if (e->order == 2)
-            {
-              if (d != 0) *d = 494;
-              if (r != 0) *r = 121;
-            }
-          break;
-
-        case 9:
-          if (d != 0) *d = 190;
-          if (r != 0) *r = 142;
-          break;
-
-        case 14:
-          if (d != 0) *d = 452;
-          if (r != 0) *r = 163;
-          break;
-
-        case 15:
-          if (e->order == 1)
-            {
-              if (d != 0) *d = 335;
-              if (r != 0) *r = 163;
-            }
-          else if (e->order == 2)
-            {
-              if (d != 0) *d = 544;
-              if (r != 0) *r = 150;
-            }
-          break;
-
-        case 16:
-          if (e->order == 1)
-            {
-              if (r != 0) *r = 157.4;
-            }
-          else if (e->order == 2)
-            {
-              if (d != 0) *d = 522;
-              if (r != 0) *r = 143;
-            }
-          break;
-
-        case 53:
-          if (d != 0) *d = 201;
-          break;
-        }
-      break;
-
-    case 9:
-      switch (v->atom->atno)
-        {
-        case 9:
-          if (d != 0) *d = 155;
-          if (r != 0) *r = 142;
-          break;
-          
-        case 14:
-          if (d != 0) *d = 565;
-          if (r != 0) *r = 160;
-
-        case 15:
-          if (d != 0) *d = 490;
-          if (r != 0) *d = 154;
-          break;
-
-        case 16:
-          if (d != 0) *d = 284;
-          if (r != 0) *r = 156;
-        }
-      break;
-
-    case 14:
-      switch (v->atom->atno)
-        {
-        case 14:
-          if (d != 0) *d = 222;
-          if (r != 0) *r = 233;
-          break;
-          
-        case 16:
-          if (d != 0) *d = 293;
-          if (r != 0) *r = 200;
-          break;
-
-        case 17:
-          if (d != 0) *d = 381;
-          if (r != 0) *r = 202;
-          break;
-
-        case 35:
-          if (d != 0) *d = 310;
-          if (r != 0) *r = 215;
-          break;
-
-        case 53:
-          if (d != 0) *d = 234;
-          if (r != 0) *r = 243;
-          break;
-        }
-      break;
-      
-    case 15:
-      switch (v->atom->atno)
-        {
-        case 15:
-          if (d != 0) *d = 201;
-          if (r != 0) *r = 221;
-          break;
-          
-        case 16:
-          if (e->order == 2)
-            {
-              if (d != 0) *d = 335;
-              if (r != 0) *r = 186;
-            }
-          break;
+/*
+ * these are from http://cccbdb.nist.gov/
+ *
+ * BONDS[u][v][order] with u <= v; order 0 is for pairs whose entry
+ * doesn't depend on the bond order (or as the fallback for those that
+ * do). unlisted entries are all 0s.
+ */
+static const bond_t BONDS[BOND_ATOMS][BOND_ATOMS][BOND_ORDER_MAX+1] = {
+  [BOND_H][BOND_H][0] = {432, 74},
+  [BOND_H][BOND_B][0] = {389, 119},
+  [BOND_H][BOND_C][0] = {411, 109},
+  [BOND_H][BOND_N][0] = {386, 101},
+  [BOND_H][BOND_O][0] = {459, 96},
+  [BOND_H][BOND_F][0] = {565, 92},
+  [BOND_H][BOND_Si][0] = {318, 148},
+  [BOND_H][BOND_P][0] = {322, 144},
+  [BOND_H][BOND_S][0] = {363, 134},
+  [BOND_H][BOND_Cl][0] = {428, 127},
+  [BOND_H][BOND_Br][0] = {362, 141},
+  [BOND_H][BOND_I][0] = {295, 161},
+
+  [BOND_B][BOND_B][0] = {293, 170.2},
+  [BOND_B][BOND_C][0] = {536, 149.1},
+  [BOND_B][BOND_F][0] = {613, 130.7},
+  [BOND_B][BOND_Cl][0] = {456, 175},
+  [BOND_B][BOND_Br][0] = {377, 188.8},
+
+  [BOND_C][BOND_C][1] = {346, 154},
+  [BOND_C][BOND_C][2] = {602, 134},
+  [BOND_C][BOND_C][3] = {835, 120},
+  [BOND_C][BOND_N][1] = {305, 147},
+  [BOND_C][BOND_N][2] = {615, 129},
+  [BOND_C][BOND_N][3] = {887, 116},
+  [BOND_C][BOND_O][1] = {358, 143},
+  [BOND_C][BOND_O][2] = {799, 120},
+  [BOND_C][BOND_O][3] = {1072, 113},
+  [BOND_C][BOND_F][0] = {485, 135},
+  [BOND_C][BOND_Si][0] = {318, 185},
+  [BOND_C][BOND_P][0] = {264, 184},
+  [BOND_C][BOND_S][1] = {272, 182},
+  [BOND_C][BOND_S][2] = {573, 160},
+  [BOND_C][BOND_Cl][0] = {327, 177},
+  [BOND_C][BOND_Br][0] = {285, 194},
+  [BOND_C][BOND_I][0] = {213, 214},
+
+  [BOND_N][BOND_N][1] = {167, 145},
+  [BOND_N][BOND_N][2] = {418, 125},
+  [BOND_N][BOND_N][3] = {942, 110},
+  [BOND_N][BOND_O][1] = {201, 140},
+  [BOND_N][BOND_O][2] = {607, 121},
+  [BOND_N][BOND_F][0] = {283, 136},
+  [BOND_N][BOND_Si][0] = {355, 157.19},
+  [BOND_N][BOND_S][0] = {0, 149.7}, /* N=S */
+  [BOND_N][BOND_Cl][0] = {313, 175},
+
+  [BOND_O][BOND_O][1] = {142, 148},
+  [BOND_O][BOND_O][2] = {494, 121},
+  [BOND_O][BOND_F][0] = {190, 142},
+  [BOND_O][BOND_Si][0] = {452, 163},
+  [BOND_O][BOND_P][1] = {335, 163},
+  [BOND_O][BOND_P][2] = {544, 150},
+  [BOND_O][BOND_S][1] = {0, 157.4},
+  [BOND_O][BOND_S][2] = {522, 143},
+  [BOND_O][BOND_I][0] = {201, 0},
+
+  [BOND_F][BOND_F][0] = {155, 142},
+  [BOND_F][BOND_Si][0] = {565, 160},
+  [BOND_F][BOND_P][0] = {490, 154},
+  [BOND_F][BOND_S][0] = {284, 156},
+
+  [BOND_Si][BOND_Si][0] = {222, 233},
+  [BOND_Si][BOND_S][0] = {293, 200},
+  [BOND_Si][BOND_Cl][0] = {381, 202},
+  [BOND_Si][BOND_Br][0] = {310, 215},
+  [BOND_Si][BOND_I][0] = {234, 243},
+
+  [BOND_P][BOND_P][0] = {201, 221},
+  [BOND_P][BOND_S][2] = {335, 186},
+  [BOND_P][BOND_Cl][0] = {326, 203},
+  [BOND_P][BOND_Br][0] = {264, 0},
+  [BOND_P][BOND_I][0] = {184, 0},
+
+  [BOND_S][BOND_S][2] = {425, 149},
+  [BOND_S][BOND_Cl][0] = {255, 207},
+
+  [BOND_Cl][BOND_Cl][0] = {240, 199},
+  [BOND_Cl][BOND_I][0] = {208, 232},
+
+  [BOND_Br][BOND_Br][0] = {190, 228},
+  [BOND_Br][BOND_I][0] = {175, 0},
+
+  [BOND_I][BOND_I][0] = {148, 267}
+};
 
-        case 17:
-          if (d != 0) *d = 326;
-          if (r != 0) *r = 203;
-          break;
-          
-        case 35:
-          if (d != 0) *d = 264;
-          break;
+/*
+ * entry of bond e of g; one with neither energy nor length if there's none
+ */
+static const bond_t *
+bond_lookup (const inchi_t *g, int e)
+{
+  static const bond_t none = {0, 0};
+  int u = g->atom[g->eu[e]]->atno, v = g->atom[g->ev[e]]->atno;
+  const bond_t *b;
 
-        case 53:
-          if (d != 0) *d = 184;
-        }
-      break;
+  if (u > BOND_ATNO_MAX || v > BOND_ATNO_MAX)
+    return &none;
 
-    case 16:
-      switch (v->atom->atno)
-        {
-        case 16:
-          if (e->order == 2)
-            {
-              if (d != 0) *d = 425;
-              if (r != 0) *r = 149;
-            }
-          break;
+  u = BOND_ATOM[u];
+  v = BOND_ATOM[v];
+  if (u > v)
+    {
+      int t = u;
+      u = v;
+      v = t;
+    }
 
-        case 17:
-          if (d != 0) *d = 255;
-          if (r != 0) *r = 207;
-          break;
-        }
-      break;
+  b = BONDS[u][v];
+  if (g->order[e] > 0 && g->order[e] <= BOND_ORDER_MAX
+      && (b[g->order[e]].d > 0 || b[g->order[e]].r > 0))
+    return b + g->order[e];
+  return b;
+}
 
-    case 17:
-      if (v->atom->atno == 17)
-        {
-          if (d != 0) *d = 240;
-          if (r != 0) *r = 199;
-        }
-      else if (v->atom->atno == 53)
-        {
-          if (d != 0) *d = 208;
-          if (r != 0) *r = 232;
-        }
-      break;
+void
+bond_energy_length (const inchi_t *g, int e,
+                    double *d /* energy */, double *r /* length */)
+{
+  const bond_t *b = bond_lookup (g, e);
 
-    case 35:
-      if (v->atom->atno == 35)
-        {
-          if (d != 0) *d = 190;
-          if (r != 0) *r = 228;
-        }
-      else if (v->atom->atno == 53)
-        {
-          if (d != 0) *d = 175;
-        }
-      break;
+  /*
+   * d is kJ/mol
+   * r is pm
+   */
+  if (d != 0) *d = b->d;
+  if (r != 0) *r = b->r > 0 ? b->r : 1000;
+}
 
-    case 53:
-      if (v->atom->atno == 53)
-        {
-          if (d != 0) *d = 148;
-          if (r != 0) *r = 267;
-        }
-      break;
-    }
+/*
+ * bond energy of e in g relative to that of a C-C single bond, or 1 if
+ * there's no entry for it
+ */
+double
+bond_weight (const inchi_t *g, int e)
+{
+  const bond_t *b = bond_lookup (g, e);
+  return b->d > 0 ? b->d / BONDS[BOND_C][BOND_C][1].d : 1.;
 }
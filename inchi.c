@@ -2,189 +2,382 @@
 #define __inchi_private_h__
 #include "_inchi.h"
 
-#define __set_edge(i,j) G[(i)*size+(j)] = G[(j)*size+(i)] = 1
-#define __get_edge(i,j) G[(i)*size+(j)]
+/* prefixes of LAYER_C..LAYER_I, in the order the layers come in */
+static const char LAYER_PREFIX[] = "chqpbtmsi";
+
+/*
+ * index the layers of inchi into L in one pass; the string ends at the
+ * first whitespace. a layer that's out of order (or unknown) ends the
+ * main ones.
+ */
+static void
+layers_index (layers_t *L, const char *inchi)
+{
+  const char *p = strchr (inchi, '/'), *q;
+  int k, last = LAYER_FORMULA;
+
+  L->inchi = inchi;
+  L->nsemi = 0;
+  for (k = 0; k < LAYERS; ++k)
+    L->begin[k] = L->end[k] = 0;
+  L->first[LAYER_FORMULA] = 0;
+
+  if (p != 0) /* skip over the version */
+    for (L->begin[last] = ++p; ; ++p)
+      {
+        if (*p == ';')
+          {
+            if (L->nsemi == L->size)
+              {
+                L->size = L->size > 0 ? 2*L->size : 16;
+                L->semi = realloc (L->semi, L->size*sizeof (L->semi[0]));
+              }
+            L->semi[L->nsemi++] = p;
+          }
+        else if (*p == '/' || *p == '\0' || isspace (*p))
+          {
+            L->end[last] = p;
+            q = *p == '/' && p[1] != '\0' ? strchr (LAYER_PREFIX, p[1]) : 0;
+            k = q != 0 ? q - LAYER_PREFIX + LAYER_C : -1;
+            if (k <= last)
+              break;
+
+            while (last < k)
+              L->first[++last] = L->nsemi;
+            L->begin[k] = p + 2; /* skip over the prefix */
+            ++p;
+          }
+      }
+
+  while (last < LAYERS)
+    L->first[++last] = L->nsemi;
+}
+
+/*
+ * number of ;-separated components of layer k of L
+ */
+static int
+layer_sections (const layers_t *L, int k)
+{
+  return L->begin[k] != 0 ? L->first[k+1] - L->first[k] + 1 : 0;
+}
+
+/*
+ * start of component s of layer k of L and in *end where it stops
+ */
+static const char *
+layer_section (const layers_t *L, int k, int s, const char **end)
+{
+  const char **semi = L->semi + L->first[k];
+  *end = s < L->first[k+1] - L->first[k] ? semi[s] : L->end[k];
+  return s > 0 ? semi[s-1] + 1 : L->begin[k];
+}
+
+/*
+ * the connection layer is tokenized a block of CONNECTION_BLOCK bytes at
+ * a time: vector compares classify every byte as a digit, one of
+ * CONNECTION_PUNCT or neither (an error), and the numbers are read off
+ * between the bits of the resulting delimiter mask
+ */
+#if defined(__AVX2__)
+# include <immintrin.h>
+# define CONNECTION_BLOCK 32
+#elif defined(__SSE2__)
+# include <emmintrin.h>
+# define CONNECTION_BLOCK 16
+#else
+# define CONNECTION_BLOCK 31
+#endif
+
+/* atom numbers longer than this can't be read into an int */
+#define CONNECTION_DIGITS 9
+
+/* what may separate the atom numbers */
+static const char CONNECTION_PUNCT[] = "-(),;*/";
 
+#ifdef __GNUC__
+# define connection_ctz(x) __builtin_ctz (x)
+#else
 static int
-parse_inchi_graph (int **pG, size_t *psize, char *inchi, char errmsg[])
+connection_ctz (uint32_t x)
+{
+  int k = 0;
+  for (; !(x & 1); x >>= 1)
+    ++k;
+  return k;
+}
+#endif
+
+/*
+ * bit i set for every s[i], i < n <= CONNECTION_BLOCK, that isn't a
+ * digit; *bad gets those that aren't in CONNECTION_PUNCT either
+ */
+static uint32_t
+connection_delimiters (const char *s, int n, uint32_t *bad)
+{
+  uint32_t mask = 0;
+  int i;
+
+#if defined(__AVX2__)
+  if (n == CONNECTION_BLOCK)
+    {
+      __m256i c = _mm256_loadu_si256 ((const __m256i *)s), p;
+      __m256i d = _mm256_sub_epi8 (c, _mm256_set1_epi8 ('0'));
+      d = _mm256_cmpeq_epi8 (_mm256_min_epu8 (d, _mm256_set1_epi8 (9)), d);
+      for (p = d, i = 0; CONNECTION_PUNCT[i] != '\0'; ++i)
+        p = _mm256_or_si256 (p, _mm256_cmpeq_epi8
+                             (c, _mm256_set1_epi8 (CONNECTION_PUNCT[i])));
+      *bad = ~(uint32_t)_mm256_movemask_epi8 (p);
+      return ~(uint32_t)_mm256_movemask_epi8 (d);
+    }
+#elif defined(__SSE2__)
+  if (n == CONNECTION_BLOCK)
+    {
+      __m128i c = _mm_loadu_si128 ((const __m128i *)s), p;
+      __m128i d = _mm_sub_epi8 (c, _mm_set1_epi8 ('0'));
+      d = _mm_cmpeq_epi8 (_mm_min_epu8 (d, _mm_set1_epi8 (9)), d);
+      for (p = d, i = 0; CONNECTION_PUNCT[i] != '\0'; ++i)
+        p = _mm_or_si128 (p, _mm_cmpeq_epi8
+                          (c, _mm_set1_epi8 (CONNECTION_PUNCT[i])));
+      *bad = ~(uint32_t)_mm_movemask_epi8 (p) & 0xffff;
+      return ~(uint32_t)_mm_movemask_epi8 (d) & 0xffff;
+    }
+#endif
+
+  for (*bad = 0, i = 0; i < n; ++i)
+    if ((unsigned)(s[i] - '0') > 9)
+      {
+        mask |= (uint32_t)1 << i;
+        if (s[i] == '\0' || strchr (CONNECTION_PUNCT, s[i]) == 0)
+          *bad |= (uint32_t)1 << i;
+      }
+  return mask;
+}
+
+#define __add_edge(i,j) do { E[2*ne] = (i); E[2*ne+1] = (j); ++ne; } while (0)
+
+/*
+ * bonds of the connection layer inchi..end-1 as pairs of (1-based)
+ * vertices into *pE, *pne of them; returns the number of vertices
+ */
+static int
+parse_inchi_graph (int **pE, size_t *psize, int *pne,
+                   const char *inchi, const char *end, char errmsg[])
 {
   char pc;
-  int *G, *ppv, *pv, nv = 0, vv = 0;
-  size_t size = strlen (inchi);
-  char *ptr = inchi;
-  char *end = inchi + size;
+  int *E, *ppv, *pv, nv = 0, vv = 0, ne = 0, i, k, n;
+  size_t size = end - inchi;
+  const char *ptr = inchi;
+  uint32_t mask, bad;
 
+  /* every bond takes a number and a separator */
   if (size > *psize)
     {
-      *pG = realloc (*pG, size*size*sizeof (int));
+      E = realloc (*pE, 2*size*sizeof (int));
+      if (E == 0)
+        {
+          sprintf (errmsg, "Out of memory for connection layer");
+          *pne = 0;
+          return -1;
+        }
+      *pE = E;
       *psize = size;
     }
   else
     size = *psize;
 
-  G = *pG;
-  (void) memset (G, 0, size*size*sizeof (int));
-  /*
-  { int i = 0, j;
-    for (; i < size; ++i)
-      for (j = 0; j < size; ++j)
-        G[i*size+j] = 0;
-  }
-  */
-  
+  E = *pE;
   ppv = pv = malloc (sizeof (int)*size);
-  for (pc = 0; ptr < end; ++ptr)
+  if (ppv == 0)
     {
-      int v = strtol (ptr, &ptr, 10);
-      if (v > nv)
-        nv = v;
-
-      switch (pc) 
+      sprintf (errmsg, "Out of memory for connection layer");
+      *pne = 0;
+      return -1;
+    }
+  for (pc = 0; ptr < end; ptr += i)
+    {
+      n = MIN (end - ptr, CONNECTION_BLOCK);
+      mask = connection_delimiters (ptr, n, &bad);
+      if (n < CONNECTION_BLOCK && (unsigned)(ptr[n-1] - '0') <= 9)
+        mask |= (uint32_t)1 << n; /* the end of the layer ends the number */
+      else if (mask == 0)
         {
-        case '(': /* push */
-          *pv++ = vv;
-          /* fall through */
+          sprintf (errmsg, "Number too long in connection layer");
+          free (ppv);
+          *pne = 0;
+          return -1;
+        }
 
-        case '-':
-          __set_edge (vv, v);
-          break;
-          
-        case ')': /* pop */
-          if (pv > ppv)
+      /* a number, if any, before every delimiter; the rest waits */
+      for (i = 0; mask != 0; mask &= mask-1, i = k+1)
+        {
+          int v = 0;
+          k = connection_ctz (mask);
+          if (bad & (uint32_t)1 << k)
             {
-              --pv;
-              __set_edge (*pv, v);
+              sprintf (errmsg, "Unknown character '%c' in connection layer",
+                       ptr[k]);
+              free (ppv);
+              *pne = 0;
+              return -1;
             }
-          else
-            sprintf (errmsg, "Mismatch ()'s in connection layer");
-          break;
-
-        case ',':
-          if (pv > ppv)
+          if (k - i > CONNECTION_DIGITS)
             {
-              __set_edge (pv[-1], v);
+              sprintf (errmsg, "Number too long in connection layer");
+              free (ppv);
+              *pne = 0;
+              return -1;
             }
-          else
-            sprintf (errmsg, "Character ',' not within () block");
-          break;
+          for (; i < k; ++i)
+            v = 10*v + ptr[i] - '0';
+          if (v > INCHI_MAXV)
+            {
+              sprintf (errmsg, "Atom number %d in connection layer is too "
+                       "large (> %d)", v, INCHI_MAXV);
+              free (ppv);
+              *pne = 0;
+              return -1;
+            }
+          if (v > nv)
+            nv = v;
 
-        case '/':
-        case '\0': /* end */
-          break;
+          switch (pc) 
+            {
+            case '(': /* push */
+              *pv++ = vv;
+              /* fall through */
 
-        case ';': /* component */
+            case '-':
+              __add_edge (vv, v);
+              break;
           
-          break;
+            case ')': /* pop */
+              if (pv > ppv)
+                {
+                  --pv;
+                  __add_edge (*pv, v);
+                }
+              else
+                sprintf (errmsg, "Mismatch ()'s in connection layer");
+              break;
 
-        case '*': /* multiplicity */
-          nv = v; /* reset */
-          vv = 0;
-          break;
+            case ',':
+              if (pv > ppv)
+                {
+                  __add_edge (pv[-1], v);
+                }
+              else
+                sprintf (errmsg, "Character ',' not within () block");
+              break;
 
-        default:
-          sprintf (errmsg, "Unknown character '%c' in connection layer", pc);
-          free (ppv);
-          return -1;
+            case '/':
+            case '\0': /* end */
+              break;
+
+            case ';': /* component */
+          
+              break;
+
+            case '*': /* multiplicity */
+              nv = v; /* reset */
+              vv = 0;
+              break;
+
+            default:
+              sprintf (errmsg, "Unknown character '%c' in connection layer",
+                       pc);
+              free (ppv);
+              *pne = 0;
+              return -1;
+            }
+          pc = ptr[k];
+          vv = v;
         }
-      pc = *ptr;
-      vv = v;
     }
   free (ppv);
 
+  *pne = ne;
   return nv;
 }
 
-#undef __set_edge
-#undef __get_edge
+#undef __add_edge
 
 static formula_t *
-create_formula (int index, int count, const element_t *el)
+formula_section (formula_t **formula, int *n)
 {
-  formula_t *f = malloc (sizeof (formula_t));
-  f->index = index;
-  f->count = count;
-  f->element = el;
-  f->next = 0;
+  formula_t *f;
+  *formula = realloc (*formula, (*n+1)*sizeof (formula_t));
+  f = *formula + (*n)++;
+  f->multiplier = 1;
+  f->nv = 0;
+  f->nh = 0;
+  f->element = 0;
   return f;
 }
 
 static void
-destroy_formula (formula_t *f)
+formula_add (formula_t *f, const element_t *el, int count)
 {
-  while (f != 0)
+  int k;
+  if (el->atno == 1)
+    f->nh += count;
+  else if (count > 0)
     {
-      formula_t *next = f->next;
-      free (f);
-      f = next;
+      f->element = realloc (f->element, (f->nv + count)*sizeof (f->element[0]));
+      for (k = 0; k < count; ++k)
+        f->element[f->nv++] = el;
     }
 }
 
-static int
-update_formula (formula_t **head, formula_t **current,
-                int *index, int multi, int count, const element_t *el)
+static void
+destroy_formula (formula_t *f, int n)
 {
-  formula_t *f = create_formula (*index, count, el);
-  if (*current != 0)
-    (*current)->next = f;
-  else
-    *head = f;
-  *current = f;
-  
-  /* expand */
-  if (multi > 1)
-    {
-      int k;
-      formula_t *h = *head;
-      while (h->index != *index)
-        h = h->next;
-      
-      for (k = 1; k < multi; ++k)
-        {
-          formula_t *p = h;
-          ++*index;
-          while (p->index == h->index)
-            {
-              f = create_formula (*index, p->count, p->element);
-              (*current)->next = f;
-              *current = f;
-              p = p->next;
-            }
-        }
-    }
-  
-  return multi*count;
+  int k;
+  for (k = 0; k < n; ++k)
+    free (f[k].element);
+  free (f);
+}
+
+/*
+ * section of the formula that component index falls into (sections
+ * count as many components as their multiplier) or 0
+ */
+static const formula_t *
+formula_component (const formula_t *f, int n, int index)
+{
+  int k;
+  for (k = 0; k < n; ++k)
+    if ((index -= f[k].multiplier) < 0)
+      return f + k;
+  return 0;
 }
 
 static int
-parse_formula (formula_t **formula, char *err, const char *inchi)
+parse_formula (formula_t **formula, int *n, char *err, const layers_t *L)
 {
-  char *p = strchr (inchi, '/');
+  char *p = (char *) L->begin[LAYER_FORMULA];
+  const char *end = L->end[LAYER_FORMULA];
   const element_t *el = 0;
-  int count = 0, multi = 1, index = 0, total = 0;
-  formula_t *current = 0, *head = 0;
+  int count = 0, lead = 1, total = 0;
+  formula_t *f;
 
+  *formula = 0;
+  *n = 0;
   if (p == 0)
-    {
-      *formula = 0;
-      return 0;
-    }
+    return 0;
   
-  ++p; /* skip over / */
-  while (*p != '/')
+  f = formula_section (formula, n);
+  while (p < end)
     {
       if (isalpha (*p))
         {
           if (el != 0)
             {
-              formula_t *f = create_formula (index, count, el);
-              if (current != 0)
-                current->next = f;
-              else
-                head = f;
-              current = f;
-              total += multi*count;
+              formula_add (f, el, count);
+              total += f->multiplier*count;
             }
           
+          lead = 0;
           el = element_lookup_symbol (p);
           if (el != 0)
             {
@@ -195,10 +388,8 @@ parse_formula (formula_t **formula, char *err, const char *inchi)
             {
               sprintf (err,
                        "** Unknown atom in formula at position %ld: %s **\n",
-                       p - inchi, p);
-              el = 0;
+                       p - L->inchi, p);
               count = 0;
-              multi = 1;
               ++p;
             }
         }
@@ -206,796 +397,520 @@ parse_formula (formula_t **formula, char *err, const char *inchi)
         {
           /* number */
           count = (int) strtol (p, &p, 10);
-          if (el == 0)
+          if (lead)
             {
               /* multiplicity.. */
-              multi = count;
+              f->multiplier = count;
             }
         }
       else if (*p == '.')
         {
           if (el != 0)
             {
-              total += update_formula (&head, &current,
-                                       &index, multi, count, el);
+              formula_add (f, el, count);
+              total += f->multiplier*count;
             }
           el = 0;
           count = 0;
-          multi = 1;
-          ++index;
+          lead = 1;
+          f = formula_section (formula, n);
           ++p;
         }
       else
-        sprintf (err, "** Uknown character in formula: %c **\n", *p);
+        {
+          sprintf (err, "** Uknown character in formula: %c **\n", *p);
+          ++p;
+        }
     }
   
   if (el != 0)
     {
-      total += update_formula (&head, &current, &index, multi, count, el);
+      formula_add (f, el, count);
+      total += f->multiplier*count;
     }
-  *formula = head;
   
   return total;
 }
 
 static hlayer_t *
-create_hlayer (int index, int atom)
+hlayer_section (hlayer_t **hlayer, int *n)
 {
-  hlayer_t *h = malloc (sizeof (hlayer_t));
-  h->index = index;
-  h->atom = atom;
+  hlayer_t *h;
+  *hlayer = realloc (*hlayer, (*n+1)*sizeof (hlayer_t));
+  h = *hlayer + (*n)++;
+  h->multiplier = 1;
+  h->n = 0;
+  h->size = 0;
   h->count = 0;
   h->group = 0;
-  h->element = 0;
-  h->next = 0;
   return h;
 }
 
+/*
+ * index of atom a (1-based) in h, which is grown to cover it
+ */
+static int
+hlayer_atom (hlayer_t *h, int a)
+{
+  int k;
+  if (a > h->size)
+    {
+      h->size = MAX (a, 2*h->size);
+      h->count = realloc (h->count, h->size*sizeof (short));
+      h->group = realloc (h->group, h->size*sizeof (short));
+    }
+  for (k = h->n; k < a; ++k)
+    {
+      h->count[k] = 0;
+      h->group[k] = -1;
+    }
+  h->n = MAX (h->n, a);
+  return a-1;
+}
+
+/*
+ * same as formula_component for the /h layer
+ */
+static const hlayer_t *
+hlayer_component (const hlayer_t *h, int n, int index)
+{
+  int k;
+  for (k = 0; k < n; ++k)
+    if ((index -= h[k].multiplier) < 0)
+      return h + k;
+  return 0;
+}
+
 static void
-destroy_hlayer (hlayer_t *h)
+destroy_hlayer (hlayer_t *h, int n)
 {
-  while (h != 0)
+  int k;
+  for (k = 0; k < n; ++k)
     {
-      hlayer_t *next = h->next;
-      free (h);
-      h = next;
+      free (h[k].count);
+      free (h[k].group);
     }
+  free (h);
 }
 
+/*
+ * atom a of h takes count Hs if it's in a mobile group, otherwise it waits
+ * in pending for the H count that follows; an atom listed more than once
+ * keeps its first entry
+ */
+#define __hlayer_add(a) do {                            \
+    int __k = hlayer_atom (h, (a));                     \
+    if (h->group[__k] < 0)                              \
+      {                                                 \
+        if (shared)                                     \
+          {                                             \
+            h->count[__k] = count;                      \
+            h->group[__k] = group;                      \
+          }                                             \
+        else                                            \
+          {                                             \
+            if (np == psize)                            \
+              {                                         \
+                psize = 2*psize;                        \
+                pending = realloc (pending, psize*sizeof (int)); \
+              }                                         \
+            h->group[__k] = 0;                          \
+            pending[np++] = __k;                        \
+          }                                             \
+      }                                                 \
+    ++total;                                            \
+  } while (0)
+
 static int
-parse_layer_h (hlayer_t **hlayer, char *err, const char *inchi)
+parse_layer_h (hlayer_t **hlayer, int *nh, char *err, const layers_t *L)
 {
-  char *p = strstr (inchi, "/h");
-  int pn = 0, n, count, group = 0, shared = 0, index = 0, total = 0;
-  hlayer_t *head = 0, *current = 0;
+  const char *end;
+  char *p;
+  int pn = 0, n = 0, count = 0, group = 0, shared = 0, total = 0;
+  int s, ns = layer_sections (L, LAYER_H), np = 0, psize = 64, *pending;
+  hlayer_t *h;
   
-  if (p == 0)
-    {
-      *hlayer = 0;
-      return 0;
-    }
+  *hlayer = 0;
+  *nh = 0;
+  if (ns == 0)
+    return 0;
 
-  p += 2; /* skip over /h */
-  while (*p != '/' && *p != '\0')
+  pending = malloc (psize*sizeof (int));
+  for (s = 0; s < ns; ++s)
     {
-      switch (*p)
+      p = (char *) layer_section (L, LAYER_H, s, &end);
+      h = hlayer_section (hlayer, nh);
+      np = 0;
+      while (p < end)
         {
-        case '1': case '2': case '3':
-        case '4': case '5': case '6':
-        case '7': case '8': case '9':
-          n = strtol (p, &p, 10);
-          if (n > 0)
+          switch (*p)
             {
-              if (*p != '*')
+            case '1': case '2': case '3':
+            case '4': case '5': case '6':
+            case '7': case '8': case '9':
+              n = strtol (p, &p, 10);
+              if (n > 0)
                 {
-                  hlayer_t *h = create_hlayer (index, n);
-                  if (shared)
+                  if (*p != '*')
+                    __hlayer_add (n);
+                  else
                     {
-                      h->count = count;
-                      h->group = group;
+                      h->multiplier = n;
+                      ++p;
                     }
-                  
-                  if (head == 0)
-                    head = h;
-                  else
-                    current->next = h;
-                  current = h;
-                  ++total;
+                }
+              break;
+
+            case '-':
+              pn = n;
+              n = strtol (p+1, &p, 10);
+              if (n > 0 && pn > 0)
+                { int a = pn+1, t = shared;
+                  for (shared = 0; a <= n; ++a)
+                    __hlayer_add (a);
+                  shared = t;
+                  pn = 0;
                 }
               else
-                sprintf (err, "** Warning: ignore multiplicity %d "
-                         "in /h layer **\n", n);
-            }
-          break;
-
-        case '-':
-          pn = n;
-          n = strtol (p+1, &p, 10);
-          if (n > 0 && pn > 0)
-            { int p = pn+1;
-              for (; p <= n; ++p)
                 {
-                  hlayer_t *h = create_hlayer (index, p);
-                  if (head == 0)
-                    head = h;
-                  else
-                    current->next = h;
-                  current = h;
-                  ++total;
+                  sprintf (err, "** Invalid range in /h layer: %d-%d **\n",
+                           pn, n);
                 }
-              pn = 0;
-            }
-          else
-            {
-              sprintf (err, "** Invalid range in /h layer: %d-%d **\n",
-                       pn, n);
-            }
-          break;
+              break;
 
-        case ',':
-          ++p;
-          break;
+            case ',':
+              ++p;
+              break;
 
-        case '(':
-          shared ^= 1; /* toggle parity */
-          ++group;
-          ++p;
-          break;
+            case '(':
+              shared ^= 1; /* toggle parity */
+              ++group;
+              ++p;
+              break;
           
-        case ')':
-          shared ^= 1;
-          ++p;
-          break;
+            case ')':
+              shared ^= 1;
+              ++p;
+              break;
 
-        case 'H':
-          count = 1;
-          if (isdigit (p[1]))
-            count = strtol (p+1, &p, 10);
-          else
-            ++p;
+            case 'H':
+              count = 1;
+              if (isdigit (p[1]))
+                count = strtol (p+1, &p, 10);
+              else
+                ++p;
 
-          if (!shared)
-            {
-              hlayer_t *h = head;
-              while (h != 0)
+              if (!shared)
                 {
-                  if (h->count == 0)
-                    h->count = count;
-                  h = h->next;
+                  while (np > 0)
+                    h->count[pending[--np]] = count;
                 }
-            }
-          break;
+              break;
 
-        case '*': /* multiplicity (ignore for now) */
-          ++p;
-          break;
-          
-        case ';': /* component */
-          ++index;
-          ++p;
-          break;
+            case '*':
+              ++p;
+              break;
 
-        default:
-          sprintf (err, "** Warning: unknown character in /h layer: '%c'\n",
-                   *p);
-          ++p;
-        }
-    } /* while() */
+            default:
+              sprintf (err,
+                       "** Warning: unknown character in /h layer: '%c'\n",
+                       *p);
+              ++p;
+            }
+        } /* while() */
+    }
 
-  *hlayer = head;
+  free (pending);
   return total;
 }
 
-static vertex_t *
-create_vertex (inchi_t *g, int index, int degree)
-{
-  vertex_t *v = malloc (sizeof (vertex_t) + sizeof (edge_t*)*degree);
-  v->index = index;
-  v->degree = degree;
-  v->charge = 0;
-  v->atom = 0;
-  v->hcount = 0;
-  v->hgroup = 0;
-  v->hshare = 0;
-  v->flags = 0;
-  v->graph = g;  
-  v->edges = (edge_t **)((unsigned char *)v + sizeof (vertex_t));
-  (void) memset (v->edges, 0, degree*sizeof (edge_t *));
-  return v;
-}
+#undef __hlayer_add
 
-static void
-destroy_vertex (vertex_t *v)
+/*
+ * the arrays of g for nv vertices and ne edges, in one block; returns -1
+ * if it can't be allocated
+ */
+static int
+create_graph (inchi_t *g, int nv, int ne)
 {
-  if (v != 0)
-    free (v);
-}
+  int words = nv <= INCHI_BITS_MAXG ? (nv+63)/64 : 0;
+  size_t size = (size_t)nv*sizeof (element_t *)
+    + (size_t)nv*words*sizeof (uint64_t)
+    + ((size_t)nv+1 + 6*(size_t)ne)*sizeof (int)
+    + (size_t)nv*sizeof (unsigned)
+    + (5*(size_t)nv + ne)*sizeof (short);
+  unsigned char *p = malloc (size);
 
-static void
-destroy_edge (edge_t *e)
-{
-  edge_t *next;
-  while (e != 0)
-    {
-      next = e->next;
-      free (e);
-      e = next;
-    }
+  if (p == 0)
+    return -1;
+
+  (void) memset (p, 0, size);
+  g->atom = (const element_t **)p;
+  g->words = words;
+  g->bits = words > 0 ? (uint64_t *)(p + nv*sizeof (element_t *)) : 0;
+  g->vp = (int *)(p + nv*sizeof (element_t *) + nv*words*sizeof (uint64_t));
+  g->vj = g->vp + nv+1;
+  g->ve = g->vj + 2*ne;
+  g->eu = g->ve + 2*ne;
+  g->ev = g->eu + ne;
+  g->flags = (unsigned *)(g->ev + ne);
+  g->degree = (short *)(g->flags + nv);
+  g->charge = g->degree + nv;
+  g->hcount = g->charge + nv;
+  g->hshare = g->hcount + nv;
+  g->hgroup = g->hshare + nv;
+  g->order = g->hgroup + nv;
+  g->nv = nv;
+  g->ne = ne;
+  return 0;
 }
 
-static edge_t *
-create_edge (int index, vertex_t *u, vertex_t *v)
+int
+_inchi_edge_other (const inchi_t *g, int e, int u)
 {
-  edge_t *e = malloc (sizeof (edge_t));
-  e->index = index;
-  e->order = 1;
-  e->u = u;
-  e->v = v;
-  e->next = 0;
-  return e;
+  return g->eu[e] == u ? g->ev[e] : g->eu[e];
 }
 
-vertex_t *
-_inchi_edge_other (const edge_t *e, const vertex_t *v)
+/*
+ * edge between u and v or -1
+ */
+int
+_inchi_vertex_edge (const inchi_t *g, int u, int v)
 {
-  return e->u == v ? e->v : e->u;
+  int q;
+  for (q = g->vp[u]; q < g->vp[u+1]; ++q)
+    if (g->vj[q] == v)
+      return g->ve[q];
+  return -1;
 }
 
 void
-_inchi_vertex_set (vertex_t *v, unsigned flag)
+_inchi_vertex_set (inchi_t *g, int u, unsigned flag)
 {
-  v->flags |= 1<<flag;
+  g->flags[u] |= 1<<flag;
 }
 
 int
-_inchi_vertex_get (const vertex_t *v, unsigned flag)
+_inchi_vertex_get (const inchi_t *g, int u, unsigned flag)
 {
   unsigned mask = 1<<flag;
-  return (v->flags & mask) == mask;
+  return (g->flags[u] & mask) == mask;
 }
 
+/*
+ * the graph of the ne bonds E (pairs of 1-based vertices, in any order
+ * and possibly repeated) over g->nv vertices: edges are numbered in order
+ * of their endpoints, which two passes of counting sort (by the larger
+ * endpoint, then stably by the smaller one) give in O(nv + ne); returns
+ * -1 if it runs out of memory
+ */
 static int
-implicit_hcount (const vertex_t *u)
+edge_closure (inchi_t *g, const int *E, int ne)
 {
-  int v = 0, k;
-  for (k = 0; k < u->degree; ++k)
-    v += u->edges[k]->order;
-  
-  switch (u->atom->atno)
+  int i, k, m, e, nv = g->nv, *eu, *ev, *tmp, *sorted, *count;
+
+  eu = malloc ((4*(size_t)ne + nv+1)*sizeof (int));
+  if (eu == 0)
+    return -1;
+  ev = eu + ne;
+  tmp = ev + ne;
+  sorted = tmp + ne;
+  count = sorted + ne;
+
+  for (k = 0, m = 0; k < ne; ++k)
     {
-    case 5: v = 3 - v; break;
-    case 6: v = 4 - v; break;
-    case 7: case 15:
-      if (v <= 3) v = 3 - v;
-      else v = 5 - v;
-      break;
-    case 8: v = 2 - v; break;
-    case 9: v = 1 - v; break;
-    case 14: v = 4 - v; break;
-    case 16:
-      if (u->degree <= 2) v = 2 - v;
-      else if (u->degree < 4) v = 4 - v;
-      else v = 6 - v;
-      break;
-    case 17: v = 1 - v; break;
-    case 35: case 53: v = 1 - v; break;
-    default: v = -1000;
+      int u = E[2*k]-1, v = E[2*k+1]-1;
+      if (u < 0 || v < 0 || u >= nv || v >= nv || u == v)
+        continue;
+      eu[m] = MIN (u, v);
+      ev[m++] = MAX (u, v);
     }
-  
-  return v;
-}
 
-static void
-_edge_closure (int *visited, vertex_t *u, edge_t **edge,
-               vertex_t **const *neighbors, inchi_t *g)
-{
-  if (!visited[u->index])
+  (void) memset (count, 0, (nv+1)*sizeof (int));
+  for (k = 0; k < m; ++k)
+    ++count[ev[k]+1];
+  for (i = 0; i < nv; ++i)
+    count[i+1] += count[i];
+  for (k = 0; k < m; ++k)
+    tmp[count[ev[k]]++] = k;
+
+  (void) memset (count, 0, (nv+1)*sizeof (int));
+  for (k = 0; k < m; ++k)
+    ++count[eu[k]+1];
+  for (i = 0; i < nv; ++i)
+    count[i+1] += count[i];
+  for (k = 0; k < m; ++k)
+    sorted[count[eu[tmp[k]]]++] = tmp[k];
+
+  /* without the repeats */
+  for (k = 0, e = 0; k < m; ++k)
+    if (k == 0 || eu[sorted[k]] != eu[sorted[k-1]]
+        || ev[sorted[k]] != ev[sorted[k-1]])
+      sorted[e++] = sorted[k];
+
+  if (create_graph (g, nv, e) < 0)
     {
-      int k;
+      free (eu);
+      return -1;
+    }
 
-      visited[u->index] = 1;
-      for (k = 0; k < u->degree; ++k)
+  for (k = 0; k < g->ne; ++k)
+    {
+      int u = eu[sorted[k]], v = ev[sorted[k]];
+      g->eu[k] = u;
+      g->ev[k] = v;
+      g->order[k] = 1;
+      ++g->degree[u];
+      ++g->degree[v];
+      if (g->bits != 0)
         {
-          vertex_t *v = neighbors[u->index][k];
-          if (*edge == 0 || (*edge != 0 && (*edge)->u != v))
-            {
-              edge_t *e = g->E;
-              /* not very efficient here.. */
-              while (e != 0)
-                {
-                  /* make sure we don't have an edge in the 
-                   * opposite direction */
-                  if (e->u == v && e->v == u)
-                    break;
-                  e = e->next;
-                }
-              
-              if (e == 0)
-                {
-                  e = create_edge (++g->ne, u, v);
-                  if (*edge != 0)
-                    (*edge)->next = e;
-                  else
-                    g->E = e;
-                  *edge = e;
-                  
-                  _edge_closure (visited, v, edge, neighbors, g);
-                }
-            }
+          g->bits[u*g->words + v/64] |= (uint64_t)1 << (v%64);
+          g->bits[v*g->words + u/64] |= (uint64_t)1 << (u%64);
         }
     }
-}
-
-static void
-vertex_add_edge (vertex_t *v, edge_t *edge)
-{
-  int k = 0;
-  for (; k < v->degree; ++k)
-    if (v->edges[k] == 0)
-      break;
-  
-  if (k == v->degree)
-    fprintf (stderr, "** Error: vertex %d is already filled! **\n", v->index);
-  else
-    v->edges[k] = edge;
-}
 
-static edge_t *
-vertex_get_edge (vertex_t *u, vertex_t *v)
-{
-  int i;
-  for (i = 0; i < u->degree; ++i)
-    if (v == _inchi_edge_other (u->edges[i], u))
-      return u->edges[i];
-  
-  return 0;
-}
+  for (i = 0, k = 0; i < nv; ++i)
+    {
+      g->vp[i] = count[i] = k;
+      k += g->degree[i];
+    }
+  g->vp[nv] = k;
 
-static int
-compare_edge (const void *p1, const void *p2)
-{
-  const edge_t *e1 = *(edge_t * const *)p1;
-  const edge_t *e2 = *(edge_t * const *)p2;
-  if (e1->u == e2->u)
-    return e1->v->index - e2->v->index;
-  if (e1->u == e2->v)
-    return e1->v->index - e2->u->index;
-  if (e1->v == e2->u)
-    return e1->u->index - e2->v->index;
-  if (e1->v == e2->v)
-    return e1->u->index - e2->u->index;
-  /* shouldn't ever get here! */
+  /* in edge order, which keeps every neighbor list sorted */
+  for (e = 0; e < g->ne; ++e)
+    {
+      int u = g->eu[e], v = g->ev[e];
+      g->vj[count[u]] = v;
+      g->ve[count[u]++] = e;
+      g->vj[count[v]] = u;
+      g->ve[count[v]++] = e;
+    }
+  free (eu);
   return 0;
 }
 
+/*
+ * dense adjacency matrix (1-based) for inchi_matrix_A
+ */
 static void
-edge_closure (vertex_t **const *neighbors, inchi_t *g)
+create_graph_A (inchi_t *g)
 {
-  int *visited = malloc ((g->nv+1)*sizeof (int));
-  edge_t *edge = 0;
-    
-  (void) memset (visited, 0, (g->nv+1)*sizeof (int));
-  _edge_closure (visited, g->V[0], &edge, neighbors, g);
-  free (visited);
-
-  edge = g->E;
-  while (edge != 0)
-    {
-      vertex_t *u = edge->u, *v = edge->v;
-      vertex_add_edge (u, edge);
-      vertex_add_edge (v, edge);
-      edge = edge->next;
-    }
+  int e;
+  size_t size = sizeof (int)*g->size*g->size;
 
-  /* make sure the edges are sorted based on the neigbhor index */
-  { int i;
-    for (i = 0; i < g->nv; ++i)
-      {
-        vertex_t *u = g->V[i];
-        qsort (u->edges, u->degree, sizeof (u->edges[0]), compare_edge);
-      }
-  }
+  g->A = malloc (size);
+  (void) memset (g->A, 0, size);
+  for (e = 0; e < g->ne; ++e)
+    __A(g->eu[e]+1, g->ev[e]+1) = __A(g->ev[e]+1, g->eu[e]+1) = 1;
 }
 
+#ifdef SPECTRAL_DEBUG
 static void
 edge_debug (const inchi_t *g)
 {
-  edge_t *e;
+  int e;
   double r;
   printf ("E[%d] = \n", g->ne);
-  for (e = g->E; e != 0; e = e->next)
-    { vertex_t *u = e->u, *v = e->v;
-      bond_energy_length (e, 0, &r);
-      printf ("%d: %d %c %d => r = %.0f\n", e->index, u->index,
-              e->order == 1 ? '-' : (e->order == 3 ? '#' : '='), v->index,r);
-    }
-}
-
-static int
-sort_vertex (const void *p1, const void *p2)
-{
-  const vertex_t *v1 = *(vertex_t * const *)p1;
-  const vertex_t *v2 = *(vertex_t * const *)p2;
-  int d = v2->atom->atno - v1->atom->atno;
-  if (d == 0)
-    d = v1->index - v2->index; /* order by index */
-  return d;
-}
-
-static int
-_edge_order_assignment (vertex_t *u, short *edges)
-{
-  int k, h = 0;
-
-  for (k = 0; k < u->degree; ++k)
+  for (e = 0; e < g->ne; ++e)
     {
-      edge_t *e = u->edges[k];
-      if (!edges[e->index])
-        {
-          vertex_t *v = _inchi_edge_other (e, u);
-
-          edges[e->index] = e->order;
-          /* not shared h in v */
-          if (u->hgroup == 0 && v->hgroup == 0
-              && implicit_hcount (u) > u->hcount)
-            {
-              h = implicit_hcount (v) - v->hcount;
-              if (h == 0)
-                {
-                  /* *-[*](-*)(-*)(-*) */
-                  if (u->hcount == 0 && u->degree == 4)
-                    h = 0;
-                  else
-                    {
-                      h = -1;
-                      continue;
-                    }
-                }
-              
-              e->order += h;
-            }
-
-          h = _edge_order_assignment (v, edges);
-          if (h != 0 && implicit_hcount (u) > u->hcount)
-            {
-              /* backtracking... */
-              h = implicit_hcount (v) - v->hcount;
-              e->order += h;
-              if (h < 0)
-                {
-                  /* see where else this h can go */
-                  int i;
-                  for (i = 0; i < u->degree; ++i)
-                    {
-                      e = u->edges[i];
-                      if (!edges[e->index])
-                        h = _edge_order_assignment (u, edges);
-                    }
-                }
-              
-              return h;
-            }
-        }
-    }
-
-  if (h == 0 && implicit_hcount (u) != u->hcount)
-    {
-      /* see if any of the neighboring atom contains shared h that
-       * we can use
-       */
-      if (u->hgroup == 0)
-        {
-          vertex_t *v, *vb = 0;
-          
-          h = implicit_hcount (u) - u->hcount;
-          for (k = 0; k < u->degree; ++k)
-            {
-              v = _inchi_edge_other (u->edges[k], u);
-              if (v->hshare >= h
-                  && (vb == 0
-                      || v->atom->atno > vb->atom->atno
-                      /*|| (v->atom->atno == vb->atom->atno
-                          && _inchi_vertex_get (v, FLAG_RING)
-                          && !_inchi_vertex_get (vb, FLAG_RING))*/))
-                vb = v;
-            }
-
-          if (vb != 0)
-            {
-              edge_t *e = vertex_get_edge (u, vb);
-              h = implicit_hcount (u) - u->hcount;
-              printf ("%d: %d %d %d/%d %d\n", u->index, vb->index,
-                      vb->hgroup, vb->hcount, vb->hshare, vb->atom->atno);
-              e->order += h;
-              vb->hcount = h;
-              vb->hshare = 0;
-              h = 0;
-            }
-        }
-
-      /* if thing still isn't khosher, we try to see if it might be due
-       * to charge 
-       */
-      if (h != 0)
-        {
-          /* handle limited charge */
-          switch (u->atom->atno)
-            {
-            case 8:
-              if (u->degree == 1 && u->hcount == 0)
-                {
-                  --u->charge;
-                  h = 0;
-                }
-              break;
-              
-            case 7:
-              if (u->degree == 4 && u->hcount == 0)
-                {
-                  ++u->charge;
-                  h = 0;
-                }
-              break;
-            }
-        }
+      bond_energy_length (g, e, 0, &r);
+      printf ("%d: %d %c %d => r = %.0f\n", e+1, g->eu[e]+1,
+              g->order[e] == 1 ? '-' : (g->order[e] == 3 ? '#' : '='),
+              g->ev[e]+1, r);
     }
-  
-  return h;
 }
+#endif
 
+/*
+ * sparse weighted normalized laplacian: -w(e)/sqrt(d(u) d(v)) for each
+ * bond e between u and v, with w the bond weight and d the sum of the
+ * weights at a vertex, and 1s on the diagonal
+ */
 static void
-edge_order_assignment (inchi_t *g)
+create_graph_W (inchi_t *g)
 {
-  vertex_t *v;
-  short *visited = malloc (sizeof (short) * (g->ne+1));
-  short *order = malloc (sizeof (short) * (g->ne+1));
-  int k = 0, i, q, minq;
-
-  minq = g->ne;
-  (void) memset (order, 0, sizeof (short)*(g->ne+1));
-  for (k = 0; k < g->nv; ++k)
-    {
-      v = g->V[k];
-      (void) memset (visited, 0, sizeof (short) * (g->ne+1));      
-      _edge_order_assignment (v, visited);
+  int i, k, q;
+  double *d, *w;
 
-      printf ("V = %d => ", v->index);      
-      q = 0;
-      for (i = 0; i < g->nv; ++i)
-        {
-          v = g->V[i];
-          q += implicit_hcount (v) - v->hcount;
-        }
-      printf ("%d\n", q);
-      
-      edge_debug (g);
-      if (q > 0)
-        fprintf (stderr, "** %d charge/tautomer(s) detected! **\n", q);
-      
-      if (q < minq)
-        {
-          edge_t *e = g->E;
-          for (; e != 0; e = e->next)
-            {
-              order[e->index] = e->order;
-              e->order = 1;
-            }
-          minq = q;
-          printf (" ** min q\n");
-        }
-      else
-        { edge_t *e = g->E;
-          for (; e != 0; e = e->next)
-            e->order = 1;
-        }
-    }
+  g->Wp = malloc (sizeof (int) * (g->nv+1));
+  g->Wj = malloc (sizeof (int) * (g->nv + 2*g->ne));
+  g->W = malloc (sizeof (double) * (g->nv + 2*g->ne));
+  d = malloc (sizeof (double) * (g->nv + g->ne));
+  w = d + g->nv;
 
-  { edge_t *e = g->E;
-    for (; e != 0; e = e->next)
-      e->order = order[e->index];
-  }
+  for (k = 0; k < g->ne; ++k)
+    w[k] = bond_weight (g, k);
 
-  free (order);
-  free (visited);
-}
-
-static void
-create_graph_L (vertex_t **const *neighbors, inchi_t *g)
-{
-  /* index of L and W are 1-base */
-  int i, k;
-  vertex_t *u, *v;
-  size_t size = sizeof (double)*g->size * (g->nv+1);
-
-  g->L = malloc (size);
-  (void) memset (g->L, 0, size);
-
-  printf ("L = [");  
   for (i = 0; i < g->nv; ++i)
     {
-      u = g->V[i];
-      __L(u->index, u->index) = 1.;
-      for (k = 0; k < u->degree; ++k)
+      d[i] = 0.;
+      for (k = g->vp[i]; k < g->vp[i+1]; ++k)
+        d[i] += w[g->ve[k]];
+    }
+
+  for (i = 0, q = 0; i < g->nv; ++i)
+    {
+      g->Wp[i] = q;
+      g->Wj[q] = i;
+      g->W[q++] = 1.;
+      for (k = g->vp[i]; k < g->vp[i+1]; ++k)
         {
-          v = neighbors[u->index][k];
-          __L(u->index, v->index) = __L(v->index, u->index)
-            =  -1./sqrt ((double)u->degree * v->degree);
+          g->Wj[q] = g->vj[k];
+          g->W[q++] = -w[g->ve[k]] / sqrt (d[i] * d[g->vj[k]]);
         }
-      
-      for (k = 1; k <= g->nv; ++k)
-        printf (" %-4.5f", __L(i+1, k));
-      
-      printf (";\n");
     }
-  printf ("]\n");
-}
+  g->Wp[g->nv] = q;
 
-static void
-create_graph_W (vertex_t **const *neighbors, inchi_t *g)
-{
-  size_t size = sizeof (double)*g->size * (g->nv+1);
-  g->W = malloc (size);
-  (void) memset (g->W, 0, size);
-  
+  free (d);
 }
 
-static void
-instrument_graph (inchi_t *g)
+static int
+instrument_graph (inchi_t *g, const int *E, int ne)
 {
-  int i, j, count;
-  formula_t *f = g->formula;
-  hlayer_t *h;
-  vertex_t ***neighbors;
-  int *group;
-
-  neighbors = malloc (sizeof (vertex_t **) * (g->nv+1));
-  neighbors[0] = 0;
-  
-  g->V = malloc (sizeof (vertex_t *) * g->nv);
-  /* first pass to allocate the vertices */
-  for (i = 0; i < g->nv; ++i)
-    {
-      int d = 0;
-      for (j = 0; j < g->nv; ++j)
-        if (i != j && __A(i+1, j+1))
-          ++d;
-      neighbors[i+1] = malloc (d * sizeof (vertex_t *));
-      g->V[i] = create_vertex (g, i+1, d);
-    }
-
-  /* align the formula with the component; this doesn't seem to be a clean
-   * or right way to do this??  */
-  while (f->index < g->index)
-    f = f->next;
+  int i;
+  const formula_t *f = formula_component (g->formula, g->nformula, g->index);
+  const hlayer_t *h = hlayer_component (g->hlayer, g->nhlayer, g->index);
+  const element_t *carbon = element_lookup_atno (6);
 
-  count = 0;
-  {
-    formula_t *current = f;
-    int index = f->index;
-    while (f != 0 && index == f->index)
-      {
-        if (f->element->atno != 1)
-          count += f->count;
-        f = f->next;
-      }
-    f = current;
-  }
-  
-  if (count != g->nv)
+  if (f == 0 || f->nv != g->nv)
     fprintf (stderr, "** Formula misaligned with component: "
-             "expecting %d atoms but got %d! **\n", g->nv, count);
+             "expecting %d atoms but got %d! **\n", g->nv, f ? f->nv : 0);
 
 #ifdef SPECTRAL_DEBUG
-  printf ("graph G for component %d/%d => formula %d\n",
-            g->index, g->multiplier, f->index);
+  printf ("graph G for component %d/%d => formula %ld\n",
+          g->index, g->multiplier, f ? (long)(f - g->formula) : -1l);
 #endif
-  
-  if (f->element->atno == 1)
-    f = f->next;
 
-  /* number of groups should never exceed number of atoms */
-  group = malloc (sizeof (int)* g->nv);
-  (void) memset (group, 0, sizeof (int)*g->nv);
-  
+  g->size = g->nv+1;
+  if (edge_closure (g, E, ne) < 0)
+    return -1;
+
   /*
-   * instrument vertices
+   * instrument vertices; atoms the formula doesn't cover are taken for
+   * carbons
    */
-  count = f->count;
   for (i = 0; i < g->nv; ++i)
     {
-      int k = 0;
-      vertex_t *u = g->V[i];
-      
-      /* now do the linking */
-      for (j = 0; j < g->nv; ++j)
-        if (i != j && __A(i+1, j+1))
-          neighbors[u->index][k++] = g->V[j];
-
-      u->atom = f->element;
-      for (h = g->hlayer; h != 0; h = h->next)
-        if (h->atom == u->index)
-          {
-            if (h->group > 0)
-              u->hshare = h->count;
-            else
-              u->hcount = h->count;
-            u->hgroup = h->group;
-            
-            break;
-          }
-      
-      if (--count == 0)
+      g->atom[i] = f != 0 && i < f->nv ? f->element[i] : carbon;
+      if (h != 0 && i < h->n && h->group[i] >= 0)
         {
-          f = f->next;
-          if (f != 0)
-            {
-              /* don't include Hs */
-              if (f->element->atno == 1)
-                f = f->next;
-              
-              if (f != 0)
-                count = f->count;
-            }
+          if (h->group[i] > 0)
+            g->hshare[i] = h->count[i];
+          else
+            g->hcount[i] = h->count[i];
+          g->hgroup[i] = h->group[i];
         }
     }
 
-  free (group);
-
   /* instrument edges */
-  edge_closure (neighbors, g);
-
-  //_inchi_ring_perception (g);
-  
-#if 0
-  { path_t *r = g->R;
-    i = j = 0;
-    printf ("@@ %d ring(s)...\n", g->nr);
-    for (; r != 0; r = r->next)
-      {
-        printf ("  %d:", i);
-        for (j = 0; j < r->ne; ++j)
-          printf (" [%d,%d]", r->edges[j]->u->index, r->edges[j]->v->index);
-        printf ("\n");
-        ++i;
-      }
-    printf ("\n");
-  }
-
-  /* now adjust the order */
-  edge_order_assignment (g);
-  
-  printf ("V[%d] = \n", g->nv);
-  for (i = 0; i < g->nv; ++i)
-    {
-      int k;
-      vertex_t *u = g->V[i];
-      
-      if (u->hcount > 0)
-        printf ("%d %s[H%d]:", u->index, u->atom->symbol,  u->hcount);
-      else
-        printf ("%d %s:", u->index, u->atom->symbol);
-      
-      for (k = 0; k < u->degree; ++k)
-        printf (" %d", neighbors[u->index][k]->index);
-      
-      printf ("  -- edges");
-      for (k = 0; k < u->degree; ++k)
-        { edge_t *e = u->edges[k];
-            printf (" %d[%d,%d]", e->index, e->u->index, e->v->index);
-        }
-        printf ("\n");
-    }
-#endif
-  
-#if 0
-  create_graph_L (neighbors, g);
-  create_graph_W (neighbors, g);
+  if (_inchi_kekulize (g) < 0)
+    return -1;
+#ifdef SPECTRAL_DEBUG
+  edge_debug (g);
 #endif
-  
-  for (i = 1; i <= g->nv; ++i)
-    if (neighbors[i] != 0)
-      free (neighbors[i]);
-  free (neighbors);
+
+  (void) _inchi_ring_perception (g);
+  return 0;
 }
 
 
@@ -1015,20 +930,15 @@ inchi_destroy (inchi_t *g)
   if (g->A != 0)
     free (g->A);
 
-  if (g->V != 0)
-    {
-      int i;
-      for (i = 0; i < g->nv; ++i)
-        destroy_vertex (g->V[i]);
-      free (g->V);
-      g->V = 0;
-    }
+  if (g->atom != 0)
+    free (g->atom);
   
-  if (g->L != 0)
-    free (g->L);
-
   if (g->W != 0)
-    free (g->W);
+    {
+      free (g->Wp);
+      free (g->Wj);
+      free (g->W);
+    }
 
   if (g->R != 0)
     {
@@ -1044,9 +954,11 @@ inchi_destroy (inchi_t *g)
   if (g->inchi_c != 0)
     free (g->inchi_c);
   
-  destroy_edge (g->E);
-  destroy_formula (g->formula);
-  destroy_hlayer (g->hlayer);
+  if (g->section != 0)
+    free (g->section);
+
+  destroy_formula (g->formula, g->nformula);
+  destroy_hlayer (g->hlayer, g->nhlayer);
 
   (void) memset (g, 0, sizeof (*g));
 }
@@ -1061,12 +973,28 @@ inchi_free (inchi_t *g)
     }
 }
 
-int
-inchi_parse (inchi_t *g, const char *inchi)
+/* what parse_graph keeps */
+#define PARSE_FULL      0 /* the largest component with its atoms */
+#define PARSE_LEAN      1 /* the largest component's connection layer */
+#define PARSE_SECTIONS  2 /* the connection layer of every section */
+
+/*
+ * the largest component of the /c layer of inchi into g; for PARSE_FULL
+ * its atoms from the formula and /h layers, bond orders and rings too.
+ * PARSE_SECTIONS keeps every section instead, one after the other, and
+ * returns how many there are.
+ */
+static int
+parse_graph (inchi_t *g, const char *inchi, int mode)
 {
-  char *ptr, *start, *end;
-  int *pG = 0, n;
-  size_t size = 0, psize = 0;
+  const char *ptr, *end;
+  char *p;
+  int *pE = 0, *E = 0, n, ne = 0, pne, s, component, multi;
+  size_t size = 0, psize = 0, esize = 0, csize = 0;
+  layers_t layers = {0};
+
+  /* clean up old, so no return leaves the last graph behind */
+  inchi_destroy (g);
 
   if (strncmp ("InChI=", inchi, 6) != 0)
     {
@@ -1074,102 +1002,180 @@ inchi_parse (inchi_t *g, const char *inchi)
       return -1;
     }
 
-  start = strstr (inchi, "/c");
-  if (start == 0)
+  layers_index (&layers, inchi);
+  if (layers.begin[LAYER_C] == 0)
     {
       sprintf (g->errmsg, "InChI string doesn't have connection layer");
+      free (layers.semi);
       return 0;
     }
 
-  /* clean up old */
-  inchi_destroy (g);
+  if (mode != PARSE_FULL)
+    goto connection;
 
   /* parse formula */
-  n = parse_formula (&g->formula, g->errmsg, inchi);
+  n = parse_formula (&g->formula, &g->nformula, g->errmsg, &layers);
 #ifdef SPECTRAL_DEBUG
-  { formula_t *formula = g->formula;
+  { int k, i;
     printf ("formula: %d\n", n);
-    while (formula != 0)
+    for (k = 0; k < g->nformula; ++k)
       {
-        printf ("%d: %d %s\n", formula->index,
-                formula->count, formula->element->symbol);
-        formula = formula->next;
+        printf ("%d: %d*", k, g->formula[k].multiplier);
+        for (i = 0; i < g->formula[k].nv; ++i)
+          printf (" %s", g->formula[k].element[i]->symbol);
+        printf (" H%d\n", g->formula[k].nh);
       }
   }
 #endif
   
   /* parse h layer */
-  n = parse_layer_h (&g->hlayer, g->errmsg, inchi);
+  n = parse_layer_h (&g->hlayer, &g->nhlayer, g->errmsg, &layers);
 #ifdef SPECTRAL_DEBUG
-  { hlayer_t *h = g->hlayer;
+  { int k, i;
     printf ("/h layer...%d\n", n);
-    while (h != 0)
-      {
-        printf ("%d %d %d %d\n", h->index, h->atom, h->count, h->group);
-        h = h->next;
-      }
+    for (k = 0; k < g->nhlayer; ++k)
+      for (i = 0; i < g->hlayer[k].n; ++i)
+        if (g->hlayer[k].group[i] >= 0)
+          printf ("%d %d %d %d\n", k, i+1, g->hlayer[k].count[i],
+                  g->hlayer[k].group[i]);
   }
 #endif
   
-  ptr = start + 2; /* skip over /c */
-  for (end = ptr; *end != '/' && !isspace (*end) && *end != '\0'; ++end)
-    ;
-
-  size = end - ptr;
-  start = malloc (size + 1);
-  (void) strncpy (start, ptr, size);
-  start[size] = '\0';
-
-  ptr = start;
-  for (ptr = strtok_r (ptr, ";", &end); 
-       ptr != 0; ptr = strtok_r (0, ";", &end))
+  /* sections stand for as many components as their multiplier (n*) */
+ connection:
+  for (s = 0, component = 0; s < layer_sections (&layers, LAYER_C);
+       ++s, component += multi)
     {
-      n = parse_inchi_graph (&pG, &psize, ptr, g->errmsg);
-      if (n > g->nv)
+      ptr = layer_section (&layers, LAYER_C, s, &end);
+      multi = strtol (ptr, &p, 10);
+      if (p < end && *p == '*')
+        ptr = p+1; /* don't retain the multiplicity character */
+      else
+        multi = 1;
+
+      n = parse_inchi_graph (&pE, &psize, &pne, ptr, end, g->errmsg);
+      if (n < 0)
         {
-          /* keep only the largest component */
-          if (g->A != 0)
-            free (g->A);
+          /* g->errmsg says why */
+          free (layers.semi);
+          free (pE);
+          free (E);
+          return -1;
+        }
+      if (mode == PARSE_SECTIONS)
+        {
+          /* vertices of this section come after those of the ones before */
+          section_t *c;
+          int k;
+
+          g->section = realloc (g->section,
+                                (g->nsection+1)*sizeof (section_t));
+          c = g->section + g->nsection++;
+          c->first = g->nv;
+          c->nv = MAX (n, 0);
+          c->multiplier = multi;
+          c->c = csize;
+
+          size = end - ptr;
+          if (csize + size + 1 > g->isize)
+            {
+              g->isize = MAX (2*g->isize, csize + size + 1);
+              g->inchi_c = realloc (g->inchi_c, g->isize);
+            }
+          (void) memcpy (g->inchi_c + csize, ptr, size);
+          g->inchi_c[csize + size] = '\0';
+          csize += size + 1;
 
-          g->A = pG;
+          if (ne + pne > esize)
+            {
+              esize = MAX (2*esize, ne + pne);
+              E = realloc (E, 2*esize*sizeof (int));
+            }
+          for (k = 0; k < 2*pne; ++k)
+            E[2*ne+k] = pE[k] + c->first;
+          ne += pne;
+          g->nv += c->nv;
+        }
+      else if (n > g->nv)
+        {
+          /* keep only the largest component */
+          int *t = E;
+          size_t ts = esize;
+          E = pE;
+          pE = t;
+          esize = psize;
+          psize = ts;
+          ne = pne;
           g->nv = n;
-          g->size = psize;
-          g->index = 0;
-
-          { char *p = ptr;
-            for (; p >= start; --p)
-              if (*p == ';' || *p == '\0')
-                ++g->index;
-
-            p = ptr;
-            g->multiplier = strtol (p, &p, 10);
-            if (*p != '*')
-              g->multiplier = 1;
-            else
-              /* don't retain the multiplicity character from the /c layer */
-              ptr = ++p;
-          }
+          g->index = component;
+          g->multiplier = multi;
 
-          psize = strlen (ptr);
-          if (psize > g->isize)
+          size = end - ptr;
+          if (size > g->isize)
             {
-              g->inchi_c = realloc (g->inchi_c, psize+1);
-              g->isize = psize;
+              g->inchi_c = realloc (g->inchi_c, size+1);
+              g->isize = size;
             }
-          (void) strcpy (g->inchi_c, ptr);
-
-          pG = 0;
-          psize = 0;
+          (void) memcpy (g->inchi_c, ptr, size);
+          g->inchi_c[size] = '\0';
         }
     }
-  free (start);
+  free (layers.semi);
 
-  if (pG != 0)
-    free (pG);
+  if (mode != PARSE_FULL)
+    { const element_t *carbon = element_lookup_atno (6);
+      int i;
+      g->size = g->nv+1;
+      n = edge_closure (g, E, ne);
+      for (i = 0; n == 0 && i < g->nv; ++i)
+        g->atom[i] = carbon;
+    }
+  else
+    n = instrument_graph (g, E, ne);
+  free (pE);
+  free (E);
 
-  instrument_graph (g);
+  if (n < 0)
+    {
+      sprintf (g->errmsg, "Out of memory for a graph of %d atoms", g->nv);
+      g->nv = g->ne = 0;
+      return -1;
+    }
   
-  return g->nv;
+  return mode == PARSE_SECTIONS ? g->nsection : g->nv;
+}
+
+int
+inchi_parse (inchi_t *g, const char *inchi)
+{
+  return parse_graph (g, inchi, PARSE_FULL);
+}
+
+int
+inchi_parse_c (inchi_t *g, const char *inchi)
+{
+  return parse_graph (g, inchi, PARSE_LEAN);
+}
+
+int
+inchi_parse_sections (inchi_t *g, const char *inchi)
+{
+  return parse_graph (g, inchi, PARSE_SECTIONS);
+}
+
+int
+inchi_section (const inchi_t *g, int k, int *first, int *multiplier,
+               const char **c)
+{
+  if (k < 0 || k >= g->nsection)
+    return -1;
+  if (first != 0)
+    *first = g->section[k].first;
+  if (multiplier != 0)
+    *multiplier = g->section[k].multiplier;
+  if (c != 0)
+    *c = g->inchi_c + g->section[k].c;
+  return g->section[k].nv;
 }
 
 int
@@ -1184,6 +1190,12 @@ inchi_edge_count (const inchi_t *g)
   return g->ne;
 }
 
+int
+inchi_ring_count (const inchi_t *g)
+{
+  return g->nr;
+}
+
 const char *
 inchi_layer_c (const inchi_t *g)
 {
@@ -1193,9 +1205,35 @@ inchi_layer_c (const inchi_t *g)
 const int *
 inchi_matrix_A (const inchi_t *g)
 {
+  if (g->A == 0 && g->nv > 0)
+    create_graph_A ((inchi_t *)g); /* caching only */
   return g->A;
 }
 
+const int *
+inchi_adjacency (const inchi_t *g, const int **j)
+{
+  *j = g->vj;
+  return g->vp;
+}
+
+const uint64_t *
+inchi_adjacency_bits (const inchi_t *g, int *words)
+{
+  *words = g->words;
+  return g->bits;
+}
+
+const double *
+inchi_matrix_W (const inchi_t *g, const int **p, const int **j)
+{
+  if (g->W == 0 && g->nv > 0)
+    create_graph_W ((inchi_t *)g); /* caching only */
+  *p = g->Wp;
+  *j = g->Wj;
+  return g->W;
+}
+
 size_t
 inchi_matrix_size (const inchi_t *g)
 {
@@ -1,23 +1,80 @@
 #ifndef __inchi_h__
 #define __inchi_h__
 
+#include <stdint.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/*
+ * graphs of up to this many vertices also have their adjacency as
+ * bitset rows (inchi_adjacency_bits)
+ */
+#define INCHI_BITS_MAXG 128
+
+/*
+ * atom numbers in the connection layer above this are rejected (the
+ * graph is sized by the largest); spectral.c's SPECTRAL_MAXG defaults to
+ * it, so raising one means raising this
+ */
+#ifndef INCHI_MAXV
+# define INCHI_MAXV 5000
+#endif
+
 /* opaque inchi */
 typedef struct __inchi_s inchi_t;
 
   extern inchi_t *inchi_create ();
   extern void inchi_free (inchi_t *);
   extern int inchi_parse (inchi_t *, const char *inchi);
+  /*
+   * same as inchi_parse, but only the connection layer is read: every
+   * atom is taken for a carbon with single bonds and no rings are
+   * perceived, which is all the topology needs
+   */
+  extern int inchi_parse_c (inchi_t *, const char *inchi);
+  /*
+   * same as inchi_parse_c, but every ;-separated section of the
+   * connection layer is kept, one after the other, instead of just the
+   * largest; returns the number of sections. inchi_layer_c is then that
+   * of the first.
+   */
+  extern int inchi_parse_sections (inchi_t *, const char *inchi);
+  /*
+   * vertices *first..*first+n-1 of the graph are section k, which stands
+   * for *multiplier components (n* in the /c layer) and has connection
+   * layer *c; returns n or -1 if there's no section k
+   */
+  extern int inchi_section (const inchi_t *, int k, int *first,
+                            int *multiplier, const char **c);
   extern int inchi_node_count (const inchi_t *);
   extern int inchi_edge_count (const inchi_t *);
+  extern int inchi_ring_count (const inchi_t *);
   extern const char *inchi_error (const inchi_t *);
   extern const char *inchi_layer_c (const inchi_t *);
 
   extern size_t inchi_matrix_size (const inchi_t *);  
   extern const int *inchi_matrix_A (const inchi_t *);
+  /*
+   * adjacency lists: vertex i (0-based) has neighbors j[p[i]..p[i+1]-1],
+   * in increasing order; p is returned
+   */
+  extern const int *inchi_adjacency (const inchi_t *, const int **j);
+  /*
+   * adjacency as bitset rows, *words 64-bit words each: vertex i's
+   * neighbors are the bits set in b[i*words..i*words+*words-1], vertex j
+   * being bit j%64 of word j/64; b is returned, or 0 if the graph has
+   * more than INCHI_BITS_MAXG vertices
+   */
+  extern const uint64_t *inchi_adjacency_bits (const inchi_t *, int *words);
+  /*
+   * weighted normalized laplacian, each bond weighted by its energy (see
+   * features.c), as compressed sparse rows: row i (0-based) has values
+   * W[p[i]..p[i+1]-1] in columns j[..], diagonal first
+   */
+  extern const double *inchi_matrix_W (const inchi_t *,
+                                       const int **p, const int **j);
   
 #ifdef __cplusplus
 }
@@ -0,0 +1,312 @@
+
+#define __inchi_private_h__
+#include "_inchi.h"
+
+/*
+ * bond orders from the connection and hydrogen layers: each atom is
+ * split into as many copies as the bond orders it's short of (at most 2)
+ * and a maximum matching of the copies, over the bonds, is a kekule
+ * structure; every matched pair of copies adds one to its bond's order.
+ * copies come in tiers: required ones (the valence deficit left by the
+ * atom's fixed Hs), then atoms of a mobile H group (which either take a
+ * double bond or one of the shared Hs), then pentavalent N/P (as in
+ * nitro groups and N-oxides) and ammonium. augmenting paths (Edmonds'
+ * blossoms included) are only grown from required copies and a tier is
+ * only opened up to those left over by the ones before it.
+ */
+
+#define KEKULE_TIERS 3
+
+
+typedef struct __kekule_s {
+  int n; /* copies */
+  int tier[KEKULE_TIERS]; /* copies up to the end of each tier */
+  int limit; /* copies augmenting paths may use */
+  int *owner; /* vertex index (0-based) of each copy */
+  int *p, *j; /* adjacency lists of the copies */
+  int *match, *parent, *base, *queue;
+  unsigned char *used, *blossom, *path;
+} kekule_t;
+
+static int
+implicit_hcount (const inchi_t *g, int u)
+{
+  int v = 0, q;
+  for (q = g->vp[u]; q < g->vp[u+1]; ++q)
+    v += g->order[g->ve[q]];
+
+  switch (g->atom[u]->atno)
+    {
+    case 5: v = 3 - v; break;
+    case 6: v = 4 - v; break;
+    case 7: case 15:
+      if (v <= 3) v = 3 - v;
+      else v = 5 - v;
+      break;
+    case 8: v = 2 - v; break;
+    case 9: v = 1 - v; break;
+    case 14: v = 4 - v; break;
+    case 16:
+      if (g->degree[u] <= 2) v = 2 - v;
+      else if (g->degree[u] < 4) v = 4 - v;
+      else v = 6 - v;
+      break;
+    case 17: v = 1 - v; break;
+    case 35: case 53: v = 1 - v; break;
+    default: v = -1000;
+    }
+
+  return v;
+}
+
+/*
+ * copies of u in each tier with all its bonds single
+ */
+static void
+vertex_capacity (const inchi_t *g, int u, int c[KEKULE_TIERS])
+{
+  int h = implicit_hcount (g, u), atno = g->atom[u]->atno;
+
+  c[0] = c[1] = c[2] = 0;
+  if (g->hgroup[u] != 0)
+    c[1] = MAX (0, MIN (h, 2));
+  else if ((atno == 7 || atno == 15) && g->degree[u] == 3 && g->hcount[u] == 0)
+    c[2] = 2; /* *-N(=O)=O, *=[N+](-*)-[O-] */
+  else if (atno == 7 && g->degree[u] == 4)
+    c[2] = 1; /* *=[N+](-*)(-*)-* */
+  else
+    c[0] = MAX (0, MIN (h - g->hcount[u], 2));
+}
+
+/*
+ * base of the blossom containing both a and b
+ */
+static int
+blossom_lca (kekule_t *k, int a, int b)
+{
+  (void) memset (k->path, 0, k->n);
+  for (;;)
+    {
+      a = k->base[a];
+      k->path[a] = 1;
+      if (k->match[a] < 0)
+        break;
+      a = k->parent[k->match[a]];
+    }
+  for (;;)
+    {
+      b = k->base[b];
+      if (k->path[b])
+        return b;
+      b = k->parent[k->match[b]];
+    }
+}
+
+static void
+blossom_mark (kekule_t *k, int v, int b, int child)
+{
+  while (k->base[v] != b)
+    {
+      k->blossom[k->base[v]] = k->blossom[k->base[k->match[v]]] = 1;
+      k->parent[v] = child;
+      child = k->match[v];
+      v = k->parent[k->match[v]];
+    }
+}
+
+/*
+ * end of an augmenting path from the free copy root or -1
+ */
+static int
+augmenting_path (kekule_t *k, int root)
+{
+  int i, q, v, w, b, head, tail;
+
+  for (i = 0; i < k->n; ++i)
+    {
+      k->used[i] = 0;
+      k->parent[i] = -1;
+      k->base[i] = i;
+    }
+  k->used[root] = 1;
+  k->queue[0] = root;
+  for (head = 0, tail = 1; head < tail; ++head)
+    {
+      v = k->queue[head];
+      for (q = k->p[v]; q < k->p[v+1]; ++q)
+        {
+          w = k->j[q];
+          if (w >= k->limit || k->base[v] == k->base[w] || k->match[v] == w)
+            continue;
+
+          if (w == root || (k->match[w] >= 0 && k->parent[k->match[w]] >= 0))
+            {
+              /* odd cycle; contract it */
+              b = blossom_lca (k, v, w);
+              (void) memset (k->blossom, 0, k->n);
+              blossom_mark (k, v, b, w);
+              blossom_mark (k, w, b, v);
+              for (i = 0; i < k->n; ++i)
+                if (k->blossom[k->base[i]])
+                  {
+                    k->base[i] = b;
+                    if (!k->used[i])
+                      {
+                        k->used[i] = 1;
+                        k->queue[tail++] = i;
+                      }
+                  }
+            }
+          else if (k->parent[w] < 0)
+            {
+              k->parent[w] = v;
+              if (k->match[w] < 0)
+                return w;
+              k->used[k->match[w]] = 1;
+              k->queue[tail++] = k->match[w];
+            }
+        }
+    }
+
+  return -1;
+}
+
+static void
+augment (kekule_t *k, int w)
+{
+  int v, x;
+  while (w >= 0)
+    {
+      v = k->parent[w];
+      x = k->match[v];
+      k->match[w] = v;
+      k->match[v] = w;
+      w = x;
+    }
+}
+
+/*
+ * assign the bond orders of g (all of them are 1 going in); returns the
+ * number of bond orders atoms are left short of, which usually means
+ * they're charged, or -1 if it runs out of memory (and g is left alone)
+ */
+int
+_inchi_kekulize (inchi_t *g)
+{
+  kekule_t k;
+  int i, c, q, s, t, u, w, *cap, *first, deficit = 0;
+
+  /* copies of vertex i in tier t are first[t*nv+i]..+cap[t*nv+i]-1 */
+  cap = malloc (2*KEKULE_TIERS*(size_t)g->nv*sizeof (int));
+  if (cap == 0)
+    return -1;
+  first = cap + KEKULE_TIERS*g->nv;
+  for (i = 0; i < g->nv; ++i)
+    {
+      int ci[KEKULE_TIERS];
+      vertex_capacity (g, i, ci);
+      for (t = 0; t < KEKULE_TIERS; ++t)
+        cap[t*g->nv+i] = ci[t];
+    }
+  for (t = 0, c = 0; t < KEKULE_TIERS; ++t)
+    {
+      for (i = 0; i < g->nv; ++i)
+        {
+          first[t*g->nv+i] = c;
+          c += cap[t*g->nv+i];
+        }
+      k.tier[t] = c;
+    }
+  k.n = c;
+  if (k.n == 0)
+    {
+      free (cap);
+      return 0;
+    }
+
+  /* with no required copies there's nothing to match, but an ammonium N
+     left unmatched is still charged below */
+  k.owner = malloc ((6*(size_t)k.n+1)*sizeof (int) + 3*(size_t)k.n);
+  if (k.owner == 0)
+    {
+      free (cap);
+      return -1;
+    }
+  k.p = k.owner + k.n;
+  k.match = k.p + k.n+1;
+  k.parent = k.match + k.n;
+  k.base = k.parent + k.n;
+  k.queue = k.base + k.n;
+  k.used = (unsigned char *)(k.queue + k.n);
+  k.blossom = k.used + k.n;
+  k.path = k.blossom + k.n;
+  for (q = 0; q < KEKULE_TIERS*g->nv; ++q)
+    for (s = 0; s < cap[q]; ++s)
+      k.owner[first[q]+s] = q % g->nv;
+
+  /* a copy is adjacent to every copy of its vertex's neighbors */
+  for (c = 0, q = 0; c < k.n; ++c)
+    {
+      k.p[c] = q;
+      u = k.owner[c];
+      for (i = g->vp[u]; i < g->vp[u+1]; ++i)
+        for (t = 0; t < KEKULE_TIERS; ++t)
+          q += cap[t*g->nv+g->vj[i]];
+    }
+  k.p[k.n] = q;
+  k.j = malloc (((size_t)q+1)*sizeof (int));
+  if (k.j == 0)
+    {
+      free (k.owner);
+      free (cap);
+      return -1;
+    }
+  for (c = 0; c < k.n; ++c)
+    {
+      u = k.owner[c];
+      q = k.p[c];
+      for (i = g->vp[u]; i < g->vp[u+1]; ++i)
+        {
+          w = g->vj[i];
+          for (t = 0; t < KEKULE_TIERS; ++t)
+            for (s = 0; s < cap[t*g->nv+w]; ++s)
+              k.j[q++] = first[t*g->nv+w]+s;
+        }
+    }
+
+  /* greedy start among the required copies, then augment tier by tier */
+  for (c = 0; c < k.n; ++c)
+    k.match[c] = -1;
+  for (c = 0; c < k.tier[0]; ++c)
+    for (q = k.p[c]; k.match[c] < 0 && q < k.p[c+1]; ++q)
+      if (k.j[q] < k.tier[0] && k.match[k.j[q]] < 0)
+        {
+          k.match[c] = k.j[q];
+          k.match[k.j[q]] = c;
+        }
+  for (t = 0; t < KEKULE_TIERS; ++t)
+    if (t == 0 || k.tier[t] > k.tier[t-1])
+      for (c = 0, k.limit = k.tier[t]; c < k.tier[0]; ++c)
+        if (k.match[c] < 0 && (w = augmenting_path (&k, c)) >= 0)
+          augment (&k, w);
+
+  for (c = 0; c < k.n; ++c)
+    {
+      u = k.owner[c];
+      if (k.match[c] > c)
+        ++g->order[_inchi_vertex_edge (g, u, k.owner[k.match[c]])];
+      else if (k.match[c] < 0 && c < k.tier[0])
+        {
+          if (g->atom[u]->atno == 8 && g->degree[u] == 1)
+            --g->charge[u]; /* *-[O-] */
+          ++deficit;
+        }
+      else if (k.match[c] < 0 && g->atom[u]->atno == 7 && g->degree[u] == 4)
+        ++g->charge[u]; /* *-[N+](-*)(-*)-* */
+    }
+
+  free (k.j);
+  free (k.owner);
+  free (cap);
+  return deficit;
+}
@@ -0,0 +1,382 @@
+
+#include <math.h>
+#include <float.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "lanczos.h"
+#include "tridiag.h"
+
+#ifndef MIN
+# define MIN(a,b) ((a)<(b)?(a):(b))
+#endif
+
+#ifndef MAX
+# define MAX(a,b) ((a)>(b)?(a):(b))
+#endif
+
+/*
+ * a ritz value is accepted once its error bound (residual^2/gap) is
+ * within this fraction of the value itself
+ */
+#ifndef LANCZOS_TOL
+# define LANCZOS_TOL 1e-10
+#endif
+
+/*
+ * size of the basis; once it's full, lanczos is restarted from the ritz
+ * vectors at either end of the spectrum (LANCZOS_KEEP of them at the low
+ * end, where the eigenvalues of graph laplacians cluster, and half as
+ * many at the high end) and the residual
+ */
+#ifndef LANCZOS_BASIS
+# define LANCZOS_BASIS 64
+#endif
+
+#ifndef LANCZOS_KEEP
+# define LANCZOS_KEEP 24
+#endif
+
+/*
+ * give up after this many steps per dimension
+ */
+#ifndef LANCZOS_MAXSTEPS
+# define LANCZOS_MAXSTEPS 20
+#endif
+
+struct __lanczos_s {
+  int bsize; /* allocated dimension */
+  int msize; /* allocated basis size */
+  double *V, *U; /* msize x n basis, one vector per row, and scratch */
+  double *w; /* next vector */
+  double *s; /* per component dot products for deflation */
+  double *H; /* msize x msize projection V'AV */
+  double *Z; /* its eigenvectors, one per row */
+  double *d, *e; /* its eigenvalues (ascending) and scratch */
+};
+
+lanczos_t *
+lanczos_create ()
+{
+  lanczos_t *lz = malloc (sizeof (lanczos_t));
+  if (lz != 0)
+    (void) memset (lz, 0, sizeof (*lz));
+  return lz;
+}
+
+void
+lanczos_free (lanczos_t *lz)
+{
+  if (lz != 0)
+    {
+      if (lz->V != 0)
+        free (lz->V);
+      if (lz->U != 0)
+        free (lz->U);
+      if (lz->w != 0)
+        free (lz->w);
+      if (lz->s != 0)
+        free (lz->s);
+      if (lz->H != 0)
+        free (lz->H);
+      if (lz->Z != 0)
+        free (lz->Z);
+      if (lz->d != 0)
+        free (lz->d);
+      if (lz->e != 0)
+        free (lz->e);
+      free (lz);
+    }
+}
+
+static void
+lanczos_reserve (lanczos_t *lz, int n, int m)
+{
+  if (lz->bsize < n || lz->msize < m)
+    {
+      lz->bsize = MAX (lz->bsize, n);
+      lz->msize = MAX (lz->msize, m);
+      lz->V = realloc (lz->V, (size_t)lz->msize*lz->bsize*sizeof (double));
+      lz->U = realloc (lz->U, (size_t)lz->msize*lz->bsize*sizeof (double));
+      lz->w = realloc (lz->w, lz->bsize*sizeof (double));
+      lz->s = realloc (lz->s, lz->bsize*sizeof (double));
+      lz->H = realloc (lz->H, lz->msize*lz->msize*sizeof (double));
+      lz->Z = realloc (lz->Z, lz->msize*lz->msize*sizeof (double));
+      lz->d = realloc (lz->d, lz->msize*sizeof (double));
+      lz->e = realloc (lz->e, lz->msize*sizeof (double));
+    }
+}
+
+static double
+dot (const double *x, const double *y, int n)
+{
+  double s = 0.;
+  int i;
+  for (i = 0; i < n; ++i)
+    s += x[i]*y[i];
+  return s;
+}
+
+/* x := x - sum_c (y_c'x) y_c */
+static void
+deflate (double *x, int n, const int *comp, const double *y, double *s)
+{
+  int i;
+  if (comp == 0)
+    return;
+
+  for (i = 0; i < n; ++i)
+    if (comp[i] >= 0)
+      s[comp[i]] = 0.;
+  for (i = 0; i < n; ++i)
+    if (comp[i] >= 0)
+      s[comp[i]] += y[i]*x[i];
+  for (i = 0; i < n; ++i)
+    if (comp[i] >= 0)
+      x[i] -= s[comp[i]]*y[i];
+}
+
+/*
+ * ritz values of the m x m projection H into d (ascending) and their
+ * vectors, in terms of the basis, into the rows of Z
+ */
+static int
+ritz_pairs (lanczos_t *lz, int m)
+{
+  int i, k;
+
+  for (i = 0; i < m; ++i)
+    for (k = 0; k <= i; ++k)
+      lz->U[i*m+k] = lz->H[i*lz->msize+k];
+  tridiag_reduce (lz->U, m, lz->d, lz->e, 1, 0);
+  for (i = 0; i < m; ++i)
+    for (k = 0; k < m; ++k)
+      lz->Z[i*m+k] = lz->U[k*m+i];
+  if (tridiag_ql (lz->d, lz->e, m, lz->Z) < 0)
+    return -1;
+  tridiag_sort (lz->d, lz->Z, m);
+  return 0;
+}
+
+/*
+ * error bound of the ritz value d[k] of an m-vector basis: |A x - theta
+ * x| for its ritz vector x is beta times the last component of its
+ * eigenvector of H, and the error is at most that squared over the gap
+ * to the rest of the spectrum (as estimated by the neighboring value)
+ */
+static int
+ritz_converged (const lanczos_t *lz, int m, int k, double beta)
+{
+  double theta = lz->d[k], r, gap;
+  r = beta * fabs (lz->Z[k*m+m-1]);
+  gap = fabs (theta - lz->d[k == 0 ? 1 : k-1]);
+  return r <= LANCZOS_TOL*fabs (theta) || r*r <= LANCZOS_TOL*fabs (theta)*gap;
+}
+
+/*
+ * thick restart: the first lo and the last hi ritz vectors of the m-vector
+ * basis become the first lo+hi vectors of the new one, on which the
+ * projection is diagonal; returns lo+hi
+ */
+static int
+lanczos_restart (lanczos_t *lz, int n, int m, int lo, int hi)
+{
+  int i, k, q, c;
+  double *t;
+
+  for (c = 0; c < lo+hi; ++c)
+    {
+      k = c < lo ? c : m-hi + (c-lo);
+      t = lz->U + (size_t)c*n;
+      for (i = 0; i < n; ++i)
+        t[i] = 0.;
+      for (q = 0; q < m; ++q)
+        {
+          const double *vq = lz->V + (size_t)q*n;
+          double z = lz->Z[k*m+q];
+          for (i = 0; i < n; ++i)
+            t[i] += z*vq[i];
+        }
+    }
+  (void) memcpy (lz->V, lz->U, (size_t)(lo+hi)*n*sizeof (double));
+
+  for (c = 0; c < lo+hi; ++c)
+    {
+      k = c < lo ? c : m-hi + (c-lo);
+      for (q = 0; q < lo+hi; ++q)
+        lz->H[c*lz->msize+q] = 0.;
+      lz->H[c*lz->msize+c] = lz->d[k];
+    }
+  return lo+hi;
+}
+
+int
+lanczos_extremes (lanczos_t *lz, int n, const int *p, const int *j,
+                  const double *v, const int *comp, const double *y,
+                  double *lmin, double *lmax)
+{
+  int i, q, c, m, k = 0, steps = 0, pass, dim = n, done = 0;
+  unsigned int seed = 1;
+  double anorm = 0., beta = 0., h, *V, *w;
+
+  for (i = 0; i < n; ++i)
+    {
+      h = 0.;
+      for (q = p[i]; q < p[i+1]; ++q)
+        h += fabs (v[q]);
+      if (h > anorm)
+        anorm = h;
+    }
+
+  m = MIN (LANCZOS_BASIS, n);
+  lanczos_reserve (lz, n, m);
+  w = lz->w;
+
+  /* each deflated vector takes away a dimension */
+  if (comp != 0)
+    {
+      for (i = 0; i < n; ++i)
+        lz->s[i] = 0.;
+      for (i = 0; i < n; ++i)
+        if (comp[i] >= 0 && lz->s[comp[i]] == 0.)
+          {
+            lz->s[comp[i]] = 1.;
+            --dim;
+          }
+    }
+  m = MIN (m, dim);
+
+  /* pseudo random start, so it's reproducible */
+  V = lz->V;
+  for (i = 0; i < n; ++i)
+    {
+      seed = seed*1103515245u + 12345u;
+      V[i] = ((seed >> 16) & 0x7fff)/16384. - 1.;
+    }
+  deflate (V, n, comp, y, lz->s);
+  h = sqrt (dot (V, V, n));
+  if (dim <= 0 || h == 0.)
+    return -1;
+  for (i = 0; i < n; ++i)
+    V[i] /= h;
+
+  for (;;)
+    {
+      for (c = k; c < m; ++c)
+        {
+          const double *vc = lz->V + (size_t)c*n;
+
+          for (i = 0; i < n; ++i)
+            {
+              h = 0.;
+              for (q = p[i]; q < p[i+1]; ++q)
+                h += v[q] * vc[j[q]];
+              w[i] = h;
+            }
+          ++steps;
+
+          /*
+           * column c of the projection, with w orthogonalized against the
+           * whole basis (twice is enough) and deflated
+           */
+          for (q = 0; q <= c; ++q)
+            lz->H[q*lz->msize+c] = 0.;
+          for (pass = 0; pass < 2; ++pass)
+            for (q = 0; q <= c; ++q)
+              {
+                const double *vq = lz->V + (size_t)q*n;
+                h = dot (vq, w, n);
+                for (i = 0; i < n; ++i)
+                  w[i] -= h*vq[i];
+                lz->H[q*lz->msize+c] += h;
+              }
+          for (q = 0; q < c; ++q)
+            lz->H[c*lz->msize+q] = lz->H[q*lz->msize+c];
+          deflate (w, n, comp, y, lz->s);
+          beta = sqrt (dot (w, w, n));
+
+          if (beta <= DBL_EPSILON*anorm)
+            {
+              /* the basis spans an invariant subspace */
+              m = c+1;
+              done = 1;
+              break;
+            }
+          if (c+1 < m)
+            {
+              V = lz->V + (size_t)(c+1)*n;
+              for (i = 0; i < n; ++i)
+                V[i] = w[i]/beta;
+            }
+        }
+
+      if (ritz_pairs (lz, m) < 0)
+        return -1;
+      if (done || m >= dim
+          || (ritz_converged (lz, m, 0, beta)
+              && ritz_converged (lz, m, m-1, beta)))
+        break;
+      if (steps >= LANCZOS_MAXSTEPS*dim)
+        return -1;
+
+      k = lanczos_restart (lz, n, m, MIN (LANCZOS_KEEP, m/2),
+                           MIN (LANCZOS_KEEP/2, m/4));
+      V = lz->V + (size_t)k*n;
+      for (i = 0; i < n; ++i)
+        V[i] = w[i]/beta;
+    }
+
+  *lmin = lz->d[0];
+  *lmax = lz->d[m-1];
+
+  return steps;
+}
+
+#ifdef __LANCZOS_TEST
+int main ()
+{
+  /* normalized laplacian of the path graph P6 */
+  enum { n = 6 };
+  int p[n+1], j[3*n], comp[n], i, q = 0, steps;
+  double v[3*n], y[n], deg, lmin, lmax;
+  lanczos_t *lz = lanczos_create ();
+
+  for (i = 0; i < n; ++i)
+    {
+      double di = i == 0 || i == n-1 ? 1. : 2.;
+      p[i] = q;
+      if (i > 0)
+        {
+          deg = i-1 == 0 ? 1. : 2.;
+          j[q] = i-1;
+          v[q++] = -1./sqrt (di*deg);
+        }
+      j[q] = i;
+      v[q++] = 1.;
+      if (i+1 < n)
+        {
+          deg = i+1 == n-1 ? 1. : 2.;
+          j[q] = i+1;
+          v[q++] = -1./sqrt (di*deg);
+        }
+      comp[i] = 0;
+      y[i] = sqrt (di/(2.*(n-1)));
+    }
+  p[n] = q;
+
+  steps = lanczos_extremes (lz, n, p, j, v, comp, y, &lmin, &lmax);
+  /* expected: 1 - cos(k pi/5), k = 1 and 5 */
+  printf ("%d steps: lmin = %.10f (%.10f) lmax = %.10f (%.10f)\n", steps,
+          lmin, 1.-cos (M_PI/(n-1)), lmax, 2.);
+  lanczos_free (lz);
+
+  return 0;
+}
+#endif
+
+/**
+ * Local Variables:
+ * compile-command: "gcc -Wall -g -o lanczos lanczos.c tridiag.c -D__LANCZOS_TEST -lm"
+ * End:
+ */
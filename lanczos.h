@@ -0,0 +1,39 @@
+
+#ifndef __lanczos_h__
+#define __lanczos_h__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Thick-restart Lanczos for the extreme eigenvalues of a sparse, real
+ * symmetric matrix: the basis is kept to a fixed size m (LANCZOS_BASIS)
+ * and fully orthogonalized, and once it's full it's restarted from the
+ * ritz vectors at either end. costs O(nnz + n*m) per step and O(n*m)
+ * memory instead of the O(n^3) and O(n^2) of a dense decomposition.
+ */
+
+typedef struct __lanczos_s lanczos_t;
+
+extern lanczos_t *lanczos_create ();
+extern void lanczos_free (lanczos_t *);
+
+/*
+ * smallest and largest eigenvalue of the n x n matrix in CSR form (row i
+ * has values v[p[i]..p[i+1]-1] in columns j[..]; both triangles) on the
+ * orthogonal complement of a set of unit vectors with disjoint support:
+ * vector c is y[i] for every i with comp[i] == c and 0 elsewhere
+ * (comp[i] < 0 means no vector covers i). comp may be null if there is
+ * nothing to deflate. returns the number of Lanczos steps or -1 if the
+ * complement is empty or the extremes don't converge within
+ * LANCZOS_MAXSTEPS steps per dimension (lmin and lmax aren't set then).
+ */
+extern int lanczos_extremes (lanczos_t *, int n, const int *p, const int *j,
+                             const double *v, const int *comp,
+                             const double *y, double *lmin, double *lmax);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* __lanczos_h__ */
@@ -4,71 +4,207 @@
 
 #include "periodic.h"
 
+#define ELEMENTS 118
+
 /*
- * only defined for the organic subset
+ * TABLE[atno-1]; mass in u, electronegativity (Pauling), electron
+ * affinity and first ionization energy in eV, 0 where it's not known
  */
-static struct __element_s TABLE[] = {
+static const element_t TABLE[ELEMENTS] = {
+    {"H", 1, 1.00794, 2.1, 0.75, 13.6},
+    {"He", 2, 4.002602, 0, 0, 24.5874},
+    {"Li", 3, 6.941, 0.98, 0.618, 5.3917},
+    {"Be", 4, 9.012182, 1.57, 0, 9.3227},
+    {"B", 5, 10.811, 2.0, 0.28, 8.30},
+    {"C", 6, 12.0107, 2.5, 1.26, 11.26},
+    {"N", 7, 14.0067, 3.0, 0.44, 14.53},
+    {"O", 8, 15.9994, 3.5, 1.46, 13.62},
+    {"F", 9, 18.9984, 4.0, 3.45, 17.42},
+    {"Ne", 10, 20.1797, 0, 0, 21.5645},
     {"Na", 11, 22.989, 0.93, 0.547, 5.1391},
     {"Mg", 12, 24.305, 1.2, -0.4, 7.64624},
     {"Al", 13, 26.9815, 1.5, 0.432, 5.98577},
-    {"Si", 14, 28.0844, 1.8, 1.39, 8.15},  
+    {"Si", 14, 28.0844, 1.8, 1.39, 8.15},
+    {"P", 15, 30.9737, 2.1, 0.75, 10.49},
+    {"S", 16, 32.065, 2.5, 2.0, 10.36},
     {"Cl", 17, 35.453, 3.0, 3.61, 12.97},
+    {"Ar", 18, 39.948, 0, 0, 15.7596},
+    {"K", 19, 39.0983, 0.8, 0.501, 4.34066},
     {"Ca", 20, 40.078, 1.0, -0.19, 6.11},
+    {"Sc", 21, 44.955912, 1.36, 0.188, 6.5615},
+    {"Ti", 22, 47.867, 1.54, 0.079, 6.8281},
+    {"V", 23, 50.9415, 1.63, 0.525, 6.7462},
+    {"Cr", 24, 51.9961, 1.66, 0.666, 6.7665},
+    {"Mn", 25, 54.938045, 1.55, 0, 7.434},
     {"Fe", 26, 55.845, 1.8, 0.50, 7.90},
     {"Co", 27, 58.933195, 1.8, 0.66, 7.86},
+    {"Ni", 28, 58.6934, 1.91, 1.156, 7.6399},
     {"Cu", 29, 63.546, 1.9, 1.235, 7.72638},
     {"Zn", 30, 65.38, 1.6, -0.6, 9.3942},
+    {"Ga", 31, 69.723, 1.81, 0.43, 5.9993},
     {"Ge", 32, 72.64, 1.8, 1.232, 7.8994},
-    {"As", 33, 74.9216, 2.0, 0, 0},
+    {"As", 33, 74.9216, 2.0, 0.804, 9.7886},
     {"Se", 34, 78.96, 2.4, 2.02, 9.75},
     {"Br", 35, 79.904, 2.8, 3.45, 11.81},
+    {"Kr", 36, 83.798, 3.0, 0, 13.9996},
+    {"Rb", 37, 85.4678, 0.82, 0.486, 4.1771},
+    {"Sr", 38, 87.62, 0.95, 0.048, 5.6949},
+    {"Y", 39, 88.90585, 1.22, 0.307, 6.2173},
+    {"Zr", 40, 91.224, 1.33, 0.426, 6.6339},
+    {"Nb", 41, 92.90638, 1.6, 0.893, 6.7589},
+    {"Mo", 42, 95.96, 2.16, 0.748, 7.0924},
+    {"Tc", 43, 98.0, 1.9, 0.55, 7.28},
     {"Ru", 44, 101.07, 2.2, 1.10, 7.37},
-    {"Ag", 47, 107.8682, 0.0, 1.304, 7.5762},
+    {"Rh", 45, 102.9055, 2.28, 1.137, 7.4589},
+    {"Pd", 46, 106.42, 2.2, 0.562, 8.3369},
+    {"Ag", 47, 107.8682, 1.93, 1.304, 7.5762},
     {"Cd", 48, 112.414, 1.7, -0.7, 8.9938},
-    {"Te", 54, 131.293, 0.0, 1.97, 9.01},
+    {"In", 49, 114.818, 1.78, 0.3, 5.7864},
+    {"Sn", 50, 118.71, 1.96, 1.112, 7.3439},
+    {"Sb", 51, 121.76, 2.05, 1.046, 8.6084},
+    {"Te", 52, 127.6, 2.1, 1.97, 9.01},
+    {"I", 53, 126.90447, 2.5, 3.059, 10.45},
+    {"Xe", 54, 131.293, 2.6, 0, 12.1298},
+    {"Cs", 55, 132.9054519, 0.79, 0.472, 3.8939},
+    {"Ba", 56, 137.327, 0.89, 0.145, 5.2117},
+    {"La", 57, 138.90547, 1.1, 0.47, 5.5769},
+    {"Ce", 58, 140.116, 1.12, 0, 5.5387},
+    {"Pr", 59, 140.90765, 1.13, 0, 5.473},
+    {"Nd", 60, 144.242, 1.14, 0, 5.525},
+    {"Pm", 61, 145.0, 1.13, 0, 5.582},
+    {"Sm", 62, 150.36, 1.17, 0, 5.6437},
+    {"Eu", 63, 151.964, 1.2, 0, 5.6704},
+    {"Gd", 64, 157.25, 1.2, 0, 6.1498},
+    {"Tb", 65, 158.92535, 1.1, 0, 5.8638},
+    {"Dy", 66, 162.5, 1.22, 0, 5.9389},
+    {"Ho", 67, 164.93032, 1.23, 0, 6.0215},
+    {"Er", 68, 167.259, 1.24, 0, 6.1077},
+    {"Tm", 69, 168.93421, 1.25, 0, 6.1843},
+    {"Yb", 70, 173.054, 1.1, 0, 6.2542},
+    {"Lu", 71, 174.9668, 1.27, 0.34, 5.4259},
+    {"Hf", 72, 178.49, 1.3, 0, 6.8251},
+    {"Ta", 73, 180.94788, 1.5, 0.322, 7.5496},
+    {"W", 74, 183.84, 2.36, 0.815, 7.864},
+    {"Re", 75, 186.207, 1.9, 0.15, 7.8335},
+    {"Os", 76, 190.23, 2.2, 1.078, 8.4382},
+    {"Ir", 77, 192.217, 2.2, 1.564, 8.967},
     {"Pt", 78, 195.084, 2.2, 1.10, 8.96},
     {"Au", 79, 196.9665, 2.4, 2.308, 9.2255},
+    {"Hg", 80, 200.59, 2.0, 0, 10.4375},
+    {"Tl", 81, 204.3833, 1.62, 0.2, 6.1082},
     {"Pb", 82, 207.2, 1.8, 1.39, 7.42},
-    {"Hg", 86, 222.0, 0.0, -0.19, 10.44},
-    
-    {"H", 1, 1.00794, 2.1, 0.75, 13.6},
-    {"B", 5, 10.811, 2.0, 0.28, 8.30},
-    {"C", 6, 12.0107, 2.5, 1.26, 11.26},
-    {"N", 7, 14.0067, 3.0, 0.44, 14.53},
-    {"O", 8, 15.9994, 3.5, 1.46, 13.62},
-    {"F", 9, 18.9984, 4.0, 3.45, 17.42},
-    {"P", 15, 30.9737, 2.1, 0.75, 10.49},
-    {"S", 16, 32.065, 2.5, 2.0, 10.36},
-    {"K", 19, 39.0983, 0.8, 0.501, 4.34066},
-    {"I", 53, 126.90447, 3.23, 10.45}
+    {"Bi", 83, 208.9804, 2.02, 0.946, 7.2855},
+    {"Po", 84, 209.0, 2.0, 1.9, 8.414},
+    {"At", 85, 210.0, 2.2, 2.8, 9.3},
+    {"Rn", 86, 222.0, 2.2, 0, 10.7485},
+    {"Fr", 87, 223.0, 0.7, 0.47, 4.0727},
+    {"Ra", 88, 226.0, 0.9, 0.1, 5.2784},
+    {"Ac", 89, 227.0, 1.1, 0.35, 5.17},
+    {"Th", 90, 232.03806, 1.3, 0, 6.3067},
+    {"Pa", 91, 231.03588, 1.5, 0, 5.89},
+    {"U", 92, 238.02891, 1.38, 0, 6.1941},
+    {"Np", 93, 237.0, 1.36, 0, 6.2657},
+    {"Pu", 94, 244.0, 1.28, 0, 6.026},
+    {"Am", 95, 243.0, 1.3, 0, 5.9738},
+    {"Cm", 96, 247.0, 1.3, 0, 5.9914},
+    {"Bk", 97, 247.0, 1.3, 0, 6.1979},
+    {"Cf", 98, 251.0, 1.3, 0, 6.2817},
+    {"Es", 99, 252.0, 1.3, 0, 6.42},
+    {"Fm", 100, 257.0, 1.3, 0, 6.5},
+    {"Md", 101, 258.0, 1.3, 0, 6.58},
+    {"No", 102, 259.0, 1.3, 0, 6.65},
+    {"Lr", 103, 262.0, 0, 0, 4.9},
+    {"Rf", 104, 267.0, 0, 0, 6.0},
+    {"Db", 105, 268.0, 0, 0, 0},
+    {"Sg", 106, 271.0, 0, 0, 0},
+    {"Bh", 107, 272.0, 0, 0, 0},
+    {"Hs", 108, 270.0, 0, 0, 0},
+    {"Mt", 109, 276.0, 0, 0, 0},
+    {"Ds", 110, 281.0, 0, 0, 0},
+    {"Rg", 111, 280.0, 0, 0, 0},
+    {"Cn", 112, 285.0, 0, 0, 0},
+    {"Nh", 113, 284.0, 0, 0, 0},
+    {"Fl", 114, 289.0, 0, 0, 0},
+    {"Mc", 115, 288.0, 0, 0, 0},
+    {"Lv", 116, 293.0, 0, 0, 0},
+    {"Ts", 117, 294.0, 0, 0, 0},
+    {"Og", 118, 294.0, 0, 0, 0}
 };
 
-static size_t SIZE = sizeof (TABLE) / sizeof (TABLE[0]);
+/*
+ * atomic number of each symbol by its letters: SYMBOL[a][0] for a
+ * one-letter symbol a and SYMBOL[a][b] for a two-letter one ab (0 if
+ * there's no such element)
+ */
+#define __symbol(a,b) [(a)-'A'][(b) != 0 ? (b)-'a'+1 : 0]
 
-static int
-cmp (const char *p1, const char *p2)
-{
-  for (; *p1 != '\0' && *p2 != '\0' && *p1 == *p2; ++p1, ++p2)
-    ;
-  return  (*p1 == '\0' || *p2 == '\0') ? 0 : *p1 - *p2;
-}
+static const unsigned char SYMBOL[26][27] = {
+  __symbol ('H',0) = 1, __symbol ('H','e') = 2, __symbol ('L','i') = 3,
+  __symbol ('B','e') = 4, __symbol ('B',0) = 5, __symbol ('C',0) = 6,
+  __symbol ('N',0) = 7, __symbol ('O',0) = 8, __symbol ('F',0) = 9,
+  __symbol ('N','e') = 10, __symbol ('N','a') = 11, __symbol ('M','g') = 12,
+  __symbol ('A','l') = 13, __symbol ('S','i') = 14, __symbol ('P',0) = 15,
+  __symbol ('S',0) = 16, __symbol ('C','l') = 17, __symbol ('A','r') = 18,
+  __symbol ('K',0) = 19, __symbol ('C','a') = 20, __symbol ('S','c') = 21,
+  __symbol ('T','i') = 22, __symbol ('V',0) = 23, __symbol ('C','r') = 24,
+  __symbol ('M','n') = 25, __symbol ('F','e') = 26, __symbol ('C','o') = 27,
+  __symbol ('N','i') = 28, __symbol ('C','u') = 29, __symbol ('Z','n') = 30,
+  __symbol ('G','a') = 31, __symbol ('G','e') = 32, __symbol ('A','s') = 33,
+  __symbol ('S','e') = 34, __symbol ('B','r') = 35, __symbol ('K','r') = 36,
+  __symbol ('R','b') = 37, __symbol ('S','r') = 38, __symbol ('Y',0) = 39,
+  __symbol ('Z','r') = 40, __symbol ('N','b') = 41, __symbol ('M','o') = 42,
+  __symbol ('T','c') = 43, __symbol ('R','u') = 44, __symbol ('R','h') = 45,
+  __symbol ('P','d') = 46, __symbol ('A','g') = 47, __symbol ('C','d') = 48,
+  __symbol ('I','n') = 49, __symbol ('S','n') = 50, __symbol ('S','b') = 51,
+  __symbol ('T','e') = 52, __symbol ('I',0) = 53, __symbol ('X','e') = 54,
+  __symbol ('C','s') = 55, __symbol ('B','a') = 56, __symbol ('L','a') = 57,
+  __symbol ('C','e') = 58, __symbol ('P','r') = 59, __symbol ('N','d') = 60,
+  __symbol ('P','m') = 61, __symbol ('S','m') = 62, __symbol ('E','u') = 63,
+  __symbol ('G','d') = 64, __symbol ('T','b') = 65, __symbol ('D','y') = 66,
+  __symbol ('H','o') = 67, __symbol ('E','r') = 68, __symbol ('T','m') = 69,
+  __symbol ('Y','b') = 70, __symbol ('L','u') = 71, __symbol ('H','f') = 72,
+  __symbol ('T','a') = 73, __symbol ('W',0) = 74, __symbol ('R','e') = 75,
+  __symbol ('O','s') = 76, __symbol ('I','r') = 77, __symbol ('P','t') = 78,
+  __symbol ('A','u') = 79, __symbol ('H','g') = 80, __symbol ('T','l') = 81,
+  __symbol ('P','b') = 82, __symbol ('B','i') = 83, __symbol ('P','o') = 84,
+  __symbol ('A','t') = 85, __symbol ('R','n') = 86, __symbol ('F','r') = 87,
+  __symbol ('R','a') = 88, __symbol ('A','c') = 89, __symbol ('T','h') = 90,
+  __symbol ('P','a') = 91, __symbol ('U',0) = 92, __symbol ('N','p') = 93,
+  __symbol ('P','u') = 94, __symbol ('A','m') = 95, __symbol ('C','m') = 96,
+  __symbol ('B','k') = 97, __symbol ('C','f') = 98, __symbol ('E','s') = 99,
+  __symbol ('F','m') = 100, __symbol ('M','d') = 101, __symbol ('N','o') = 102,
+  __symbol ('L','r') = 103, __symbol ('R','f') = 104, __symbol ('D','b') = 105,
+  __symbol ('S','g') = 106, __symbol ('B','h') = 107, __symbol ('H','s') = 108,
+  __symbol ('M','t') = 109, __symbol ('D','s') = 110, __symbol ('R','g') = 111,
+  __symbol ('C','n') = 112, __symbol ('N','h') = 113, __symbol ('F','l') = 114,
+  __symbol ('M','c') = 115, __symbol ('L','v') = 116, __symbol ('T','s') = 117,
+  __symbol ('O','g') = 118
+};
 
+#undef __symbol
+
+/*
+ * element whose symbol symbol starts with; a lowercase second letter is
+ * taken to be part of it if there's such an element
+ */
 const element_t *
 element_lookup_symbol (const char *symbol)
 {
-  size_t i;
-  for (i = 0; i < SIZE; ++i)
-    if (cmp (TABLE[i].symbol, symbol) == 0)
-      return &TABLE[i];
-  return 0;
+  unsigned a = (unsigned char)symbol[0] - 'A', b, atno = 0;
+
+  if (a >= 26)
+    return 0;
+
+  b = (unsigned char)symbol[1] - 'a';
+  if (b < 26)
+    atno = SYMBOL[a][b+1];
+  if (atno == 0)
+    atno = SYMBOL[a][0];
+  return atno != 0 ? TABLE + atno-1 : 0;
 }
 
 const element_t *
 element_lookup_atno (int atno)
 {
-  size_t i;
-  for (i = 0; i < SIZE; ++i)
-    if (TABLE[i].atno == atno)
-      return &TABLE[i];
-  return 0;
+  return atno >= 1 && atno <= ELEMENTS ? TABLE + atno-1 : 0;
 }
@@ -0,0 +1,550 @@
+/**
+ * API regression checks for libspectral.a that the corpus harness
+ * (bench.c) can't catch: sequences of calls on one spectral_t that must
+ * not leave a later call reading the state of an earlier molecule, and
+ * values of small graphs known in closed form. exits with the number of
+ * failed checks.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "spectral.h"
+#include "cpoly.h"
+#define __inchi_private_h__
+#include "_inchi.h"
+
+#define C20 "InChI=1S/C20H42/c1-3-5-7-9-11-13-15-17-19-20-18-16-14-12-10-8-6-4-2/h3-20H2,1-2H3"
+#define ETHANOL "InChI=1S/C2H6O/c1-2-3/h3H,2H2,1H3"
+
+static int checks, failures;
+
+static void
+check (int ok, const char *what)
+{
+  ++checks;
+  if (!ok)
+    {
+      fprintf (stderr, "** regress: %s **\n", what);
+      ++failures;
+    }
+}
+
+/* v[0..n-1] against want to within tol */
+static void
+check_values (const float *v, const double *want, int n, double tol,
+              const char *what)
+{
+  int i, ok = v != 0;
+  for (i = 0; ok && i < n; ++i)
+    ok = fabs (v[i] - want[i]) <= tol;
+  check (ok, what);
+}
+
+/*
+ * a forced bisect solver keys the graph but its digest-precision
+ * eigenvalues (neither exact nor sorted) mustn't get any further; the
+ * path P3 and the two K2 of c1-2;3-4 have spectra 0,1,2 and 0,1,1,2
+ */
+static void
+regress_bisect (spectral_t *sp)
+{
+  static const double p3[] = {0., 1., 2.}, k2k2[] = {0., 1., 1., 2.};
+  const char *key;
+  char exact[31];
+
+  key = spectral_digest (sp, "InChI=1S/C3/c1-3");
+  (void) strcpy (exact, key != 0 ? key : "");
+  check (spectral_set_solver (sp, "bisect") == 0, "force bisect");
+  key = spectral_digest (sp, "InChI=1S/C3/c1-3");
+  check (key != 0 && strcmp (key, exact) == 0, "bisect key of P3");
+  check_values (spectral_spectrum (sp), p3, 3, 1e-6, "bisect spectrum of P3");
+  check (spectral_fiedler (sp) != 0 && fabs (spectral_fiedler (sp)[1]) > .5,
+         "bisect fiedler vector of P3");
+
+  check (spectral_digest (sp, "InChI=1S/C4/c1-2;3-4") != 0,
+         "bisect digest of 2 K2");
+  check_values (spectral_spectrum (sp), k2k2, 4, 1e-6,
+                "bisect spectrum of 2 K2");
+  check (spectral_set_solver (sp, 0) == 0, "default solver");
+}
+
+/* all coefficients are compared modulo this prime */
+#define MODULUS 1000000007ull
+
+/*
+ * the coefficients of cp's last polynomial (see cpoly_bytes) modulo
+ * MODULUS into c[0..n]; returns how many there are
+ */
+static int
+cpoly_residues (unsigned long long *c, int n, const cpoly_t *cp)
+{
+  size_t size, at = 0;
+  const unsigned char *b = cpoly_bytes (cp, &size);
+  int k, i;
+
+  for (k = 0; k <= n && at + 3 <= size; ++k)
+    {
+      int sign = b[at], len = b[at+1] | b[at+2] << 8;
+      at += 3;
+      for (c[k] = 0, i = len-1; i >= 0; --i)
+        c[k] = (c[k]*256 + b[at+i]) % MODULUS;
+      if (sign && c[k] != 0)
+        c[k] = MODULUS - c[k];
+      at += len;
+    }
+  return at == size ? k : -1;
+}
+
+/* det(xD - L) of the n vertex graph with edges e[0..2*m-1] against want */
+static int
+check_cpoly (cpoly_t *cp, int n, const int *e, int m,
+             const unsigned long long *want, const char *what)
+{
+  int p[n+1], j[2*m], i, k, primes;
+  unsigned long long c[n+1];
+
+  for (i = 0; i <= n; ++i)
+    p[i] = 0;
+  for (k = 0; k < 2*m; ++k)
+    ++p[e[k]+1];
+  for (i = 0; i < n; ++i)
+    p[i+1] += p[i];
+  for (k = 0; k < m; ++k)
+    {
+      j[p[e[2*k]]++] = e[2*k+1];
+      j[p[e[2*k+1]]++] = e[2*k];
+    }
+  for (i = n; i > 0; --i)
+    p[i] = p[i-1];
+  p[0] = 0;
+
+  primes = cpoly_graph (cp, n, p, j);
+  k = primes > 0 ? cpoly_residues (c, n, cp) : -1;
+  for (i = 0; k == n+1 && i <= n; ++i)
+    if (c[i] != want[i])
+      k = -1;
+  check (k == n+1, what);
+  return primes;
+}
+
+/* c (mod MODULUS) for a small signed coefficient */
+#define __mod(c) ((c) < 0 ? MODULUS - (unsigned long long)-(c) \
+                  : (unsigned long long)(c))
+
+/*
+ * the exact characteristic polynomial det(xD - L) against hand computed
+ * ones, x^0 first: 2x(x-1)(x-2) for the path P3, 16x(x-1)^2(x-2) for the
+ * cycle C4 and 3x(x-1)^2(x-2) for the star K1,3 (their normalized
+ * laplacian spectra are 0,1,2 and 0,1,1,2, the leading coefficient the
+ * product of the degrees). the cycle C100 has 2T100(x-1) - 2 (T the
+ * chebyshev polynomial, since its adjacency eigenvalues are 2cos(2pik/n)),
+ * with a leading 2^100 that takes more than one prime.
+ */
+static void
+regress_cpoly (spectral_t *sp)
+{
+  enum { N = 100 };
+  static const int p3[] = {0,1, 1,2}, c4[] = {0,1, 1,2, 2,3, 0,3},
+    k13[] = {0,1, 0,2, 0,3};
+  const unsigned long long want_p3[] = {0, 4, __mod (-6), 2},
+    want_c4[] = {0, __mod (-32), 80, __mod (-64), 16},
+    want_k13[] = {0, __mod (-6), 15, __mod (-12), 3};
+  unsigned long long t[3][N+1], want[N+1];
+  int cn[2*N], i, k;
+  cpoly_t *cp = cpoly_create ();
+  char key[31];
+  const char *s;
+
+  check_cpoly (cp, 3, p3, 2, want_p3, "characteristic polynomial of P3");
+  check_cpoly (cp, 4, c4, 4, want_c4, "characteristic polynomial of C4");
+  check_cpoly (cp, 4, k13, 3, want_k13, "characteristic polynomial of K1,3");
+
+  /* T0 = 1, T1 = x-1, Tk+1 = 2(x-1)Tk - Tk-1 */
+  (void) memset (t, 0, sizeof (t));
+  t[0][0] = 1;
+  t[1][0] = MODULUS-1;
+  t[1][1] = 1;
+  for (k = 2; k <= N; ++k)
+    {
+      unsigned long long *a = t[k%3], *b = t[(k-1)%3], *c = t[(k-2)%3];
+      for (i = 0; i <= k; ++i)
+        a[i] = (2*((i > 0 ? b[i-1] : 0) + MODULUS - b[i])
+                + MODULUS - c[i]) % MODULUS;
+    }
+  for (i = 0; i <= N; ++i)
+    want[i] = 2*t[N%3][i] % MODULUS;
+  want[0] = (want[0] + MODULUS - 2) % MODULUS; /* N is even */
+
+  for (i = 0; i < N; ++i)
+    {
+      cn[2*i] = i;
+      cn[2*i+1] = (i+1) % N;
+    }
+  check (check_cpoly (cp, N, cn, N, want, "characteristic polynomial of C100")
+         > 1, "C100 takes more than one prime");
+  cpoly_free (cp);
+
+  /*
+   * the topology block (the first 9 chars of the key) only depends on
+   * the graph; C4 and K1,3 have the same spectrum but not polynomial
+   */
+  s = spectral_digest_exact (sp, "InChI=1S/C3/c1-3-2");
+  (void) strcpy (key, s != 0 ? s : "");
+  s = spectral_digest_exact (sp, "InChI=1S/C3/c1-2-3");
+  check (s != 0 && strncmp (s, key, 9) == 0, "exact key of P3 relabeled");
+  s = spectral_digest_exact (sp, "InChI=1S/C4/c1-2-4-3-1");
+  (void) strcpy (key, s != 0 ? s : "");
+  s = spectral_digest_exact (sp, "InChI=1S/C4/c1-2(3)4");
+  check (s != 0 && strncmp (s, key, 9) != 0, "exact keys of C4 and K1,3");
+}
+
+/*
+ * spectral_spectra of graphs whose spectra are known in closed form:
+ * adjacency, laplacian, signless laplacian and normalized laplacian of
+ * the path P3, the triangle K3 (not bipartite, so its signless spectrum
+ * isn't its laplacian's) and the star K1,3
+ */
+static void
+regress_spectra (spectral_t *sp)
+{
+  static const double
+    p3[SPECTRAL_TYPES][3] = {{-1.41421356, 0., 1.41421356}, {0., 1., 3.},
+                             {0., 1., 3.}, {0., 1., 2.}},
+    k3[SPECTRAL_TYPES][3] = {{-1., -1., 2.}, {0., 3., 3.}, {1., 1., 4.},
+                             {0., 1.5, 1.5}},
+    k13[] = {0., 1., 1., 4.};
+  static const char *types[SPECTRAL_TYPES] = {
+    "adjacency", "laplacian", "signless", "normalized"
+  };
+  const float *spectra[SPECTRAL_TYPES];
+  char what[64];
+  int t;
+
+  check (spectral_spectra (spectra, SPECTRAL_ALL, sp, "InChI=1S/C3/c1-3-2")
+         == 3, "spectra of P3");
+  for (t = 0; t < SPECTRAL_TYPES; ++t)
+    {
+      sprintf (what, "%s spectrum of P3", types[t]);
+      check_values (spectra[t], p3[t], 3, 1e-5, what);
+    }
+
+  check (spectral_spectra (spectra, SPECTRAL_ALL, sp, "InChI=1S/C3/c1-2-3-1")
+         == 3, "spectra of K3");
+  for (t = 0; t < SPECTRAL_TYPES; ++t)
+    {
+      sprintf (what, "%s spectrum of K3", types[t]);
+      check_values (spectra[t], k3[t], 3, 1e-5, what);
+    }
+
+  check (spectral_spectra (spectra, SPECTRAL_SIGNLESS, sp,
+                           "InChI=1S/C4/c1-2(3)4") == 4, "spectra of K1,3");
+  check (spectra[0] == 0 && spectra[1] == 0 && spectra[3] == 0,
+         "spectra of K1,3 outside the mask");
+  check_values (spectra[2], k13, 4, 1e-5, "signless spectrum of K1,3");
+}
+
+/*
+ * weighted keys (see features.c for the bond energies): with all bonds
+ * C-C singles, butane's weighted laplacian is its normalized one, so
+ * the keys are the same. 2-butyne's triple bond weighs t = 835/346 and
+ * its path has the weighted spectrum 0, 1 -+ 1/(1+t), 2 (bipartite, so
+ * symmetric about 1; the trace of the square gives the rest) instead of
+ * butane's 0, .5, 1.5, 2. a C-O bond weighs c = 358/346, so oxirane's
+ * triangle has 0, 1 + 1/(1+c), 2 - 1/(1+c) (its two carbons give an
+ * antisymmetric vector, the trace the last one), too close to its
+ * unweighted 0, 1.5, 1.5 for the key to tell.
+ */
+static void
+regress_weighted (spectral_t *sp)
+{
+  static const double t = 835./346., c = 358./346.,
+    butyne[] = {0., 1. - 1./(1.+t), 1. + 1./(1.+t), 2.},
+    oxirane[] = {0., 1. + 1./(1.+c), 2. - 1./(1.+c)};
+  char key[31];
+  const char *s;
+
+  s = spectral_digest (sp, "InChI=1S/C4H10/c1-3-4-2/h3-4H2,1-2H3");
+  (void) strcpy (key, s != 0 ? s : "");
+  s = spectral_digest_weighted (sp, "InChI=1S/C4H10/c1-3-4-2/h3-4H2,1-2H3");
+  check (s != 0 && strcmp (s, key) == 0, "weighted key of butane");
+
+  s = spectral_digest_weighted (sp, "InChI=1S/C4H6/c1-3-4-2/h1-2H3");
+  check (s != 0 && strncmp (s, key, 9) != 0, "weighted key of 2-butyne");
+  check_values (spectral_spectrum (sp), butyne, 4, 1e-5,
+                "weighted spectrum of 2-butyne");
+  s = spectral_digest (sp, "InChI=1S/C4H6/c1-3-4-2/h1-2H3");
+  check (s != 0 && strncmp (s, key, 9) == 0, "key of 2-butyne");
+
+  check (spectral_digest_weighted (sp, "InChI=1S/C2H4O/c1-2-3-1/h1-2H2")
+         != 0, "weighted key of oxirane");
+  check_values (spectral_spectrum (sp), oxirane, 3, 1e-5,
+                "weighted spectrum of oxirane");
+}
+
+/*
+ * the components of a mixture of benzene and twice ethanol: each has the
+ * topology and connection blocks (19 chars) of its own digest, the
+ * largest one the whole key of the mixture's, and benzene the spectrum
+ * 1 - cos(2pik/6) of the cycle C6
+ */
+static void
+regress_components (spectral_t *sp)
+{
+  static const char *mixture = "InChI=1S/C6H6.2C2H6O/"
+    "c1-2-4-6-5-3-1;2*1-2-3/h1-6H;2*3H,2H2,1H3";
+  static const double c6[] = {0., .5, .5, 1.5, 1.5, 2.};
+  const spectral_component_t *c;
+  char keys[2][31];
+  const char *s;
+  int n;
+
+  n = spectral_components (&c, sp, mixture);
+  check (n == 2, "components of benzene and 2 ethanol");
+  if (n != 2)
+    return;
+  check (c[0].multiplier == 1 && c[0].size == 6
+         && c[1].multiplier == 2 && c[1].size == 3,
+         "multipliers and sizes of benzene and 2 ethanol");
+  check_values (c[0].spectrum, c6, 6, 1e-5, "spectrum of benzene component");
+  (void) strcpy (keys[0], c[0].hashkey);
+  (void) strcpy (keys[1], c[1].hashkey);
+
+  s = spectral_digest (sp, "InChI=1S/C6H6/c1-2-4-6-5-3-1/h1-6H");
+  check (s != 0 && strncmp (s, keys[0], 19) == 0, "key of benzene component");
+  s = spectral_digest (sp, "InChI=1S/C2H6O/c1-2-3/h3H,2H2,1H3");
+  check (s != 0 && strncmp (s, keys[1], 19) == 0, "key of ethanol component");
+  s = spectral_digest (sp, mixture);
+  check (s != 0 && strcmp (s, keys[0]) == 0, "key of benzene and 2 ethanol");
+}
+
+/*
+ * spectral_moments, from closed walks, against the sums of powers of
+ * spectral_spectrum's eigenvalues; both are of the normalized laplacian
+ */
+static void
+regress_moments (spectral_t *sp)
+{
+  static const char *molecules[] = {
+    ETHANOL, C20, "InChI=1S/C6H6/c1-2-4-6-5-3-1/h1-6H",
+    "InChI=1S/C10H8/c1-2-6-10-8-4-3-7-9(10)5-1/h1-8H",
+    "InChI=1S/C6H12/c1-6(2)4-3-5-6/h3-5H2,1-2H3"
+  };
+  double moments[6], want[6];
+  const float *spectrum;
+  char what[64];
+  int i, j, k, n;
+
+  for (i = 0; i < (int)(sizeof (molecules)/sizeof (molecules[0])); ++i)
+    {
+      sprintf (what, "moments of molecule %d", i);
+      n = spectral_moments (moments, 6, sp, molecules[i]);
+      check (n > 0 && spectral_digest (sp, molecules[i]) != 0
+             && spectral_size (sp) == (size_t)n, what);
+      spectrum = spectral_spectrum (sp);
+      if (spectrum == 0 || n <= 0)
+        continue;
+
+      for (j = 0; j < 6; ++j)
+        want[j] = 0.;
+      for (k = 0; k < n; ++k)
+        {
+          double p = 1.;
+          for (j = 0; j < 6; ++j)
+            want[j] += (p *= spectrum[k]) / n;
+        }
+
+      sprintf (what, "moments of molecule %d against its spectrum", i);
+      for (j = 0; j < 6 && fabs (moments[j] - want[j]) <= 1e-4; ++j)
+        ;
+      check (j == 6, what);
+    }
+}
+
+/*
+ * bond orders and charges from _inchi_kekulize: their sum over the bonds
+ * and atoms of molecules with one kekule structure (nitro N and N-oxides
+ * take two and one double bonds, ammonium N a charge instead)
+ */
+static void
+regress_kekule ()
+{
+  static const struct {
+    const char *name, *inchi;
+    int orders, charge;
+  } molecules[] = {
+    {"benzene", "InChI=1S/C6H6/c1-2-4-6-5-3-1/h1-6H", 9, 0},
+    {"naphthalene", "InChI=1S/C10H8/c1-2-6-10-8-4-3-7-9(10)5-1/h1-8H",
+     16, 0},
+    {"nitrobenzene", "InChI=1S/C6H5NO2/c8-7(9)6-4-2-1-3-5-6/h1-5H", 14, 0},
+    {"tetramethylammonium", "InChI=1S/C4H12N/c1-5(2,3)4/h1-4H3/q+1", 4, 1},
+    {"trimethylamine oxide", "InChI=1S/C3H9NO/c1-4(2,3)5/h1-3H3", 5, 0},
+    {"acetic acid", "InChI=1S/C2H4O2/c1-2(3)4/h1H3,(H,3,4)", 4, 0},
+    {"adamantane",
+     "InChI=1S/C10H16/c1-7-2-9-4-8(1)5-10(3-7)6-9/h7-10H,1-6H2", 12, 0}
+  };
+  inchi_t *g = inchi_create ();
+  char what[64];
+  int i, k, orders, charge;
+
+  for (i = 0; i < (int)(sizeof (molecules)/sizeof (molecules[0])); ++i)
+    {
+      check (inchi_parse (g, molecules[i].inchi) > 0, molecules[i].name);
+      for (k = 0, orders = 0; k < g->ne; ++k)
+        orders += g->order[k];
+      for (k = 0, charge = 0; k < g->nv; ++k)
+        charge += g->charge[k];
+      sprintf (what, "bond orders of %s", molecules[i].name);
+      check (orders == molecules[i].orders, what);
+      sprintf (what, "charge of %s", molecules[i].name);
+      check (charge == molecules[i].charge, what);
+    }
+  inchi_free (g);
+}
+
+/*
+ * rings from _inchi_ring_perception: their number (the cyclomatic
+ * number ne - nv + 1 for these) and total size, which is only that of
+ * a smallest set of smallest rings
+ */
+static void
+regress_rings ()
+{
+  static const struct {
+    const char *name, *inchi;
+    int rings, size;
+  } molecules[] = {
+    {"benzene", "InChI=1S/C6H6/c1-2-4-6-5-3-1/h1-6H", 1, 6},
+    {"naphthalene", "InChI=1S/C10H8/c1-2-6-10-8-4-3-7-9(10)5-1/h1-8H",
+     2, 12},
+    {"anthracene", "InChI=1S/C14H10/"
+     "c1-2-6-12-10-14-8-4-3-7-13(14)9-11(12)5-1/h1-10H", 3, 18},
+    {"nitrobenzene", "InChI=1S/C6H5NO2/c8-7(9)6-4-2-1-3-5-6/h1-5H", 1, 6},
+    {"tetramethylammonium", "InChI=1S/C4H12N/c1-5(2,3)4/h1-4H3/q+1", 0, 0},
+    {"norbornane", "InChI=1S/C7H12/c1-2-7-4-3-6(1)5-7/h6-7H,1-5H2", 2, 10},
+    {"adamantane",
+     "InChI=1S/C10H16/c1-7-2-9-4-8(1)5-10(3-7)6-9/h7-10H,1-6H2", 3, 18},
+    {"cubane", "InChI=1S/C8H8/c1-2-5-3(1)7-4(1)6(2)8(5)7/h1-8H", 5, 20},
+    {"spiro[4.4]nonane", "InChI=1S/C9H16/c1-2-6-9(5-1)7-3-4-8-9/h1-8H2",
+     2, 10}
+  };
+  inchi_t *g = inchi_create ();
+  const path_t *r;
+  char what[64];
+  int i, size;
+
+  for (i = 0; i < (int)(sizeof (molecules)/sizeof (molecules[0])); ++i)
+    {
+      check (inchi_parse (g, molecules[i].inchi) > 0, molecules[i].name);
+      sprintf (what, "rings of %s", molecules[i].name);
+      check (inchi_ring_count (g) == molecules[i].rings, what);
+      for (r = g->R, size = 0; r != 0; r = r->next)
+        size += r->ne;
+      sprintf (what, "ring sizes of %s", molecules[i].name);
+      check (size == molecules[i].size, what);
+    }
+  inchi_free (g);
+}
+
+/*
+ * an inchi without a connection layer (a single atom) parses to an empty
+ * graph, not to whatever was parsed before it
+ */
+static void
+regress_no_connections (spectral_t *sp)
+{
+  static const char *water = "InChI=1S/H2O/h1H2";
+  const spectral_component_t *c;
+  inchi_t *g = inchi_create ();
+  int mode;
+
+  for (mode = 0; mode < 3; ++mode)
+    {
+      check (inchi_parse_sections (g, C20) == 1, "sections of C20");
+      check ((mode == 0 ? inchi_parse (g, water)
+              : mode == 1 ? inchi_parse_c (g, water)
+              : inchi_parse_sections (g, water)) == 0, "parse of water");
+      check (inchi_node_count (g) == 0 && inchi_edge_count (g) == 0
+             && inchi_ring_count (g) == 0, "graph of water after C20");
+      check (strcmp (inchi_error (g),
+                     "InChI string doesn't have connection layer") == 0,
+             "error for water");
+    }
+  inchi_free (g);
+
+  check (spectral_components (&c, sp, C20) == 1, "components of C20");
+  check (spectral_components (&c, sp, water) == 0,
+         "components of water after C20");
+}
+
+int
+main ()
+{
+  spectral_t *sp = spectral_create ();
+  spectral_stats_t stats;
+  double moments[4];
+  int k;
+
+  /* a bipartite graph first, so a stale spectral_vector would unfold it */
+  check (spectral_digest (sp, C20) != 0, "digest of C20");
+  check (spectral_vector (sp, 5) != 0, "vector 5 of C20");
+  check (spectral_moments (moments, 4, sp, ETHANOL) == 3, "moments");
+  for (k = 0; k < 20; ++k)
+    check (spectral_vector (sp, k) == 0, "vector after spectral_moments");
+  check (spectral_fiedler (sp) == 0, "fiedler after spectral_moments");
+
+  check (spectral_digest (sp, C20) != 0, "digest of C20");
+  check (spectral_stats (&stats, sp, ETHANOL) == 3, "stats");
+  for (k = 0; k < 20; ++k)
+    check (spectral_vector (sp, k) == 0, "vector after spectral_stats");
+
+  check (spectral_digest (sp, C20) != 0, "digest of C20");
+  check (spectral_digest (sp, "InChI=1S/C3H8/c1-3-99999") == 0,
+         "digest of a bad /c layer");
+  for (k = 0; k < 20; ++k)
+    check (spectral_vector (sp, k) == 0, "vector after a failed digest");
+  check (spectral_fiedler (sp) == 0, "fiedler after a failed digest");
+
+  /* 20 digits would overflow an int before the atom count rejects it */
+  check (spectral_digest (sp, "InChI=1S/C3H8/c1-3-12345678901234567890")
+         == 0, "digest of an overlong atom number");
+  check (strcmp (spectral_error (sp), "Number too long in connection layer")
+         == 0, "error for an overlong atom number");
+
+  /* the graph is sized by the largest atom number, so it's bounded too */
+  check (spectral_digest (sp, "InChI=1S/C2/c1-99999999") == 0,
+         "digest of an atom number above INCHI_MAXV");
+  check (strstr (spectral_error (sp), "too large") != 0,
+         "error for an atom number above INCHI_MAXV");
+
+  /* nine digits still fit an int, but used to size (and crash) the graph */
+  check (spectral_digest (sp, "InChI=1S/C3H8/c1-3-999999999") == 0,
+         "digest of a nine digit atom number");
+  check (strstr (spectral_error (sp), "too large") != 0,
+         "error for a nine digit atom number");
+
+  /* a stray byte after the last number used to be dropped */
+  check (spectral_digest (sp, "InChI=1S/C3H8/c1-3-2x") == 0,
+         "digest of a stray character in the connection layer");
+  check (strcmp (spectral_error (sp),
+                 "Unknown character 'x' in connection layer") == 0,
+         "error for a stray character in the connection layer");
+
+  check (spectral_digest (sp, ETHANOL) != 0, "digest of ethanol");
+  check (spectral_vector (sp, 1) != 0, "vector 1 of ethanol");
+
+  regress_bisect (sp);
+  regress_cpoly (sp);
+  regress_spectra (sp);
+  regress_weighted (sp);
+  regress_components (sp);
+  regress_moments (sp);
+  regress_kekule ();
+  regress_rings ();
+  regress_no_connections (sp);
+
+  printf ("regress: %d checks, %d failure(s)\n", checks, failures);
+  spectral_free (sp);
+
+  return failures;
+}
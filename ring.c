@@ -2,358 +2,301 @@
 #define __inchi_private_h__
 #include "_inchi.h"
 
+/*
+ * ring perception: bridges by Tarjan's lowpoint depth first search, then
+ * the smallest set of smallest rings (a minimum cycle basis) of each ring
+ * system, i.e., 2-edge-connected component, from Horton's candidates:
+ * for every root r and edge x-y off r's breadth first tree, the cycle
+ * r..x-y..r if the two tree paths only meet at r. there are as many of
+ * those per root as the cycle rank of the system and they're taken in
+ * order of size while they're independent over GF(2), which on rings
+ * stored as edge bitsets is gaussian elimination on machine words.
+ */
+
+#define RING_WORD(i) ((i) >> 6)
+#define RING_BIT(i) ((uint64_t)1 << ((i) & 63))
+
+typedef struct __ring_candidate_s {
+  int size;
+  int index; /* of its bitset */
+} ring_candidate_t;
+
 static path_t *
-path_create (edge_t **edges, int ne)
+path_create (int ne, int words)
 {
-  int i;
-  path_t *p = malloc (sizeof (path_t) + sizeof (edge_t *)*ne);
+  path_t *p = malloc (sizeof (path_t) + words*sizeof (uint64_t)
+                      + ne*sizeof (int));
   p->ne = ne;
-  p->edges = (edge_t **)((unsigned char *)p + sizeof (path_t));
-  for (i = 0; i < ne ; ++i)
-    p->edges[i] = edges[i];
+  p->bits = (uint64_t *)((unsigned char *)p + sizeof (path_t));
+  p->edges = (int *)(p->bits + words);
   p->prev = 0;
   p->next = 0;
   return p;
 }
 
-static void
-shortest_path_dfs (path_t **path, edge_t **edges, int *ne,
-                   short *visited, const vertex_t *start,
-                   const vertex_t *u, const vertex_t *v,
-                   const int *cost)
+static int
+compare_candidate (const void *p1, const void *p2)
 {
-  if (u == v)
-    {
-      /* new path */
-      path_t *p = path_create (edges, *ne);
-#ifdef INCHI_DEBUG
-      { int i;
-        printf ("## shortest path...%d", *ne);
-        for (i = 0; i < *ne; ++i)
-          printf (" [%d,%d]", edges[i]->u->index, edges[i]->v->index);
-        printf ("\n");
-      }
-#endif
-      p->prev = *path;
-      if (*path != 0)
-        (*path)->next = p;
-      *path = p;
-    }
-  else
-    {
-      int n = u->graph->nv+1;
-      int k, s = start->index *n;
-      
-      visited[u->index] = 1;
-      for (k = 0; k < u->degree; ++k)
-        {
-          edge_t *e = u->edges[k];
-          const vertex_t *xu = _inchi_edge_other (e, u);
-          if (cost[s+xu->index] + cost[xu->index*n+v->index]
-              <= cost[s+v->index] && !visited[xu->index])
-            {
-#ifdef INCHI_DEBUG
-              printf (" + %d: [%d,%d]\n", *ne, e->u->index, e->v->index);
-#endif
-              
-              edges[(*ne)++] = e; /* push */
-              shortest_path_dfs (path, edges, ne, visited, start, xu, v, cost);
-              
-#ifdef INCHI_DEBUG
-              e = edges[*ne-1];
-              printf (" - %d: [%d,%d]\n", *ne-1, e->u->index, e->v->index);
-#endif
-              edges[--(*ne)] = 0; /* pop */
-            }
-        }
-      visited[u->index] = 0;
-    }
+  const ring_candidate_t *c1 = p1, *c2 = p2;
+  return c1->size != c2->size ? c1->size - c2->size : c1->index - c2->index;
 }
 
-static path_t *
-shortest_paths (short *visited, const vertex_t *u,
-                const vertex_t *v, const int *cost)
+/*
+ * bridge[e] for every bridge e of g
+ */
+static void
+ring_bridges (const inchi_t *g, unsigned char *bridge, int *scratch)
 {
-  path_t *path = 0;
-  int ne = u->graph->ne;
-
-  edge_t **edges = malloc (sizeof (edge_t *) * ne);
-  (void) memset (edges, 0, sizeof (edge_t *) * ne);
-
-#ifdef INCHI_DEBUG
-  printf ("** %d - %d\n", u->index, v->index);
-#endif
-  ne = 0;
-  shortest_path_dfs (&path, edges, &ne, visited, u, u, v, cost);
+  int *pre = scratch, *low = pre + g->nv, *next = low + g->nv;
+  int *stack = next + g->nv, *pe = stack + g->nv, top, i, t = 0;
 
-  if (path != 0)
-    {
-      path_t *p = path;
-      while (p != 0)
-        {
-          path = p;
-          p = p->prev;
-        }
-    }
-  
-  free (edges);
-  return path;
-}
+  for (i = 0; i < g->nv; ++i)
+    pre[i] = -1;
 
-static void
-all_path_dfs (path_t **path, edge_t **edges, int *ne,
-              short *visited, const vertex_t *start,
-              const vertex_t *u, const vertex_t *v)
-{
-  if (u == v)
-    {
-      /* new path */
-      path_t *p = path_create (edges, *ne);
-#ifdef INCHI_DEBUG
-      { int i;
-        printf ("## all path...%d", *ne);
-        for (i = 0; i < *ne; ++i)
-          printf (" [%d,%d]", edges[i]->u->index, edges[i]->v->index);
-        printf ("\n");
+  for (i = 0; i < g->nv; ++i)
+    if (pre[i] < 0)
+      {
+        pre[i] = low[i] = t++;
+        next[i] = g->vp[i];
+        pe[i] = -1;
+        stack[top = 0] = i;
+        while (top >= 0)
+          {
+            int u = stack[top];
+            if (next[u] < g->vp[u+1])
+              {
+                int e = g->ve[next[u]], v = g->vj[next[u]++];
+                if (e == pe[u])
+                  continue;
+                if (pre[v] < 0)
+                  {
+                    pre[v] = low[v] = t++;
+                    next[v] = g->vp[v];
+                    pe[v] = e;
+                    stack[++top] = v;
+                  }
+                else
+                  low[u] = MIN (low[u], pre[v]);
+              }
+            else if (--top >= 0)
+              {
+                int p = stack[top];
+                low[p] = MIN (low[p], low[u]);
+                if (low[u] > pre[p])
+                  bridge[pe[u]] = 1;
+              }
+          }
       }
-#endif
-      
-      p->prev = *path;
-      if (*path != 0)
-        (*path)->next = p;
-      *path = p;
-    }
-  else
-    {
-      int k;
-      visited[u->index] = 1;
-      for (k = 0; k < u->degree; ++k)
-        {
-          edge_t *e = u->edges[k];
-          const vertex_t *xu = _inchi_edge_other (e, u);
-          if (!visited[xu->index])
-            {
-              edges[(*ne)++] = e; /* push */
-              all_path_dfs (path, edges, ne, visited, start, xu, v);
-              edges[--(*ne)] = 0; /* pop */
-            }
-        }
-      visited[u->index] = 0;
-    }
 }
 
-static path_t *
-all_paths (short *visited, const vertex_t *u, const vertex_t *v)
+/*
+ * the edges of the cycle in bits, in order around it
+ */
+static void
+ring_walk (path_t *ring, const inchi_t *g)
 {
-  path_t *path = 0;
-  int ne = u->graph->ne;
-  
-  edge_t **edges = malloc (sizeof (edge_t *) * ne);
-  (void) memset (edges, 0, sizeof (edge_t *) * ne);
+  int e, i, q, u;
 
-  ne = 0;
-  all_path_dfs (&path, edges, &ne, visited, u, u, v);
+  for (e = 0; !(ring->bits[RING_WORD (e)] & RING_BIT (e)); ++e)
+    ;
 
-  if (path != 0)
+  ring->edges[0] = e;
+  u = g->ev[e];
+  for (i = 1; i < ring->ne; ++i)
     {
-      path_t *p = path;
-      while (p != 0)
-        {
-          path = p;
-          p = p->prev;
-        }
-    }
-  
-  free (edges);
-  return path;
-}
-
-static int
-label_vertices (short label, short *vertex, const path_t *path)
-{
-  int i, ov = 0;
-  const edge_t *e;
-  for (i = 0; i < path->ne; ++i)
-    {
-      e = path->edges[i];
-      if (vertex[e->u->index] && vertex[e->u->index] != label)
-        ++ov;
-      vertex[e->u->index] = label;
-      if (vertex[e->v->index] && vertex[e->v->index] != label)
-        ++ov;
-      vertex[e->v->index] = label;
+      for (q = g->vp[u]; q < g->vp[u+1]; ++q)
+        if (g->ve[q] != e && (ring->bits[RING_WORD (g->ve[q])]
+                              & RING_BIT (g->ve[q])))
+          break;
+      e = g->ve[q];
+      ring->edges[i] = e;
+      u = g->vj[q];
     }
-  return ov;
 }
 
-/* determine whether q is a subpath of p */
-static int
-path_contains_path (const path_t *p, const path_t *q)
+int
+_inchi_ring_perception (inchi_t *g)
 {
-  int i, j;
-  const edge_t *e;
-
-  if (q->ne > p->ne) return 0;
+  int nv = g->nv, words = (g->ne + 63) / 64, rank = 0;
+  int i, k, r, w, c, ncand = 0, ccand = 0, nbasis = 0;
+  int *scratch, *comp, *dist, *branch, *queue, *pe, *pivot;
+  unsigned char *bridge;
+  uint64_t *cand = 0, *basis, *x;
+  ring_candidate_t *order = 0;
+  path_t *tail = 0;
 
-  /* sigh.. */
-  for (i = 0; i < q->ne; ++i)
-    {
-      e = q->edges[i];
-      for (j = 0; j < p->ne; ++j)
-        if (e->index == p->edges[j]->index)
-          break;
-      
-      if (j == p->ne)
-        return 0;
-    }
-  return 1;
-}
+  g->nr = 0;
+  g->R = 0;
+  if (g->ne == 0)
+    return 0;
 
-static int
-path_contains_edge (const path_t *p, const edge_t *e)
-{
-  int i;
-  for (i = 0; i < p->ne; ++i)
-    if (e->index == p->edges[i]->index)
-      return 1;
-  return 0;
-}
+  scratch = malloc (10*nv*sizeof (int) + g->ne);
+  comp = scratch + 5*nv;
+  dist = comp + nv;
+  branch = dist + nv;
+  queue = branch + nv;
+  pe = queue + nv;
+  bridge = (unsigned char *)(pe + nv);
+  (void) memset (bridge, 0, g->ne);
+  ring_bridges (g, bridge, scratch);
 
-static int
-paths_overlap_at_vertex (short *vertices, const path_t *p,
-                         const path_t *q, const vertex_t *u)
-{
-  return (0 == label_vertices (1, vertices, p)
-          && 1 == label_vertices (2, vertices, q) /* one vertex overlap */
-          && 2 == vertices[u->index]); /* and it's u */
-}
+  /* ring systems; vertices not on any ring are left at -1 */
+  for (i = 0; i < nv; ++i)
+    comp[i] = -1;
+  for (i = 0, c = 0; i < nv; ++i)
+    if (comp[i] < 0)
+      {
+        int head, tl, nc = 0, ec = 0;
+        comp[i] = c;
+        queue[0] = i;
+        for (head = 0, tl = 1; head < tl; ++head)
+          {
+            int u = queue[head];
+            ++nc;
+            for (k = g->vp[u]; k < g->vp[u+1]; ++k)
+              if (!bridge[g->ve[k]])
+                {
+                  int v = g->vj[k];
+                  ++ec;
+                  if (comp[v] < 0)
+                    {
+                      comp[v] = c;
+                      queue[tl++] = v;
+                    }
+                }
+          }
+        if (ec == 0)
+          comp[i] = -1; /* not on a ring */
+        else
+          {
+            rank += ec/2 - nc + 1;
+            for (head = 0; head < tl; ++head)
+              _inchi_vertex_set (g, queue[head], FLAG_RING);
+            ++c;
+          }
+      }
 
-int
-_inchi_ring_perception (inchi_t *g)
-{
-  edge_t *e;
-  path_t *p, *q, *next;
-  
-  int n = g->nv+1, i, j, k;
-  int *cost = malloc (n*n*sizeof (int));
-  short *visited = malloc (n * sizeof (short));
+  /* horton's candidates from every root */
+  for (r = 0; r < nv; ++r)
+    if (comp[r] >= 0)
+      {
+        int head, tl;
+        for (i = 0; i < nv; ++i)
+          dist[i] = -1;
+        dist[r] = 0;
+        branch[r] = -1;
+        pe[r] = -1;
+        queue[0] = r;
+        for (head = 0, tl = 1; head < tl; ++head)
+          {
+            int u = queue[head];
+            for (k = g->vp[u]; k < g->vp[u+1]; ++k)
+              {
+                int e = g->ve[k], v = g->vj[k];
+                if (bridge[e])
+                  continue;
+                if (dist[v] < 0)
+                  {
+                    dist[v] = dist[u] + 1;
+                    branch[v] = u == r ? v : branch[u];
+                    pe[v] = e;
+                    queue[tl++] = v;
+                  }
+                else if (e != pe[u] && e != pe[v] && u < v
+                         && branch[u] != branch[v])
+                  {
+                    /* r..u-v..r */
+                    if (ncand == ccand)
+                      {
+                        ccand = ccand > 0 ? 2*ccand : 64;
+                        cand = realloc (cand, ccand*words*sizeof (uint64_t));
+                        order = realloc (order,
+                                         ccand*sizeof (ring_candidate_t));
+                      }
+                    x = cand + ncand*words;
+                    (void) memset (x, 0, words*sizeof (uint64_t));
+                    x[RING_WORD (e)] |= RING_BIT (e);
+                    for (w = u; w != r; w = _inchi_edge_other (g, pe[w], w))
+                      x[RING_WORD (pe[w])] |= RING_BIT (pe[w]);
+                    for (w = v; w != r; w = _inchi_edge_other (g, pe[w], w))
+                      x[RING_WORD (pe[w])] |= RING_BIT (pe[w]);
+                    order[ncand].size = dist[u] + dist[v] + 1;
+                    order[ncand].index = ncand;
+                    ++ncand;
+                  }
+              }
+          }
+      }
 
-  (void) memset (cost, 0, sizeof (int)*n*n);
-  
-  for (i = 0; i < n; ++i)
+  /*
+   * smallest candidates first; basis rows are kept in increasing order
+   * of their lowest bit (the pivot), so reducing by them in that order
+   * never brings back a bit that's already been cleared
+   */
+  if (ncand > 0)
+    qsort (order, ncand, sizeof (ring_candidate_t), compare_candidate);
+  basis = malloc ((rank+1)*words*sizeof (uint64_t) + rank*sizeof (int));
+  pivot = (int *)(basis + (rank+1)*words);
+  x = basis + rank*words;
+  for (c = 0; c < ncand && nbasis < rank; ++c)
     {
-      k = i*n;
-      for (j = i+1; j < n; ++j)
-        cost[k+j] = cost[j*n+i] = n;
-    }
-  for (e = g->E; e != 0; e = e->next)
-    {
-      i = e->u->index;
-      j = e->v->index;
-      cost[i*n+j] = cost[j*n+i] = 1;
-    }
+      const uint64_t *y = cand + order[c].index*words;
+      int lo;
 
-  /* 1. now perform floyd-warshall's all pairs shortest path */
-  for (k = 1; k < n; ++k)
-    for (i = 1; i < n; ++i)
-      for (j = 1; j < n; ++j)
-        cost[i*n+j] = MIN (cost[i*n+j], cost[i*n+k] + cost[k*n+j]);
+      (void) memcpy (x, y, words*sizeof (uint64_t));
+      for (i = 0; i < nbasis; ++i)
+        if (x[RING_WORD (pivot[i])] & RING_BIT (pivot[i]))
+          for (w = 0; w < words; ++w)
+            x[w] ^= basis[i*words+w];
 
-  /* 2. find all basis cycles */
-  for (i = 0; i < g->nv; ++i)
-    {
-      vertex_t *u = g->V[i];
-      for (e = g->E; e != 0; e = e->next)
+      for (w = 0; w < words && x[w] == 0; ++w)
+        ;
+      if (w == words)
+        continue; /* dependent */
+
+      for (lo = 64*w; !(x[RING_WORD (lo)] & RING_BIT (lo)); ++lo)
+        ;
+      for (i = nbasis; i > 0 && pivot[i-1] > lo; --i)
         {
-          path_t *p1;
-          
-          (void) memset (visited, 0, sizeof (short) * n);
-          p1 = shortest_paths (visited, u, e->u, cost);
-          for (p = p1; p != 0;)
-            {
-              path_t *p2;
-              
-              label_vertices (1, visited, p);
-              p2 = all_paths (visited, u, e->v);
-              for (q = p2; q != 0;)
-                {
-                  /* see if p & q overlap at u */
-                  if (paths_overlap_at_vertex (visited, p, q, u))
-                    {
-                      int found = 0;
-                      path_t *r = g->R;
-                      while (r != 0)
-                        {
-                          if (path_contains_path (r, p)
-                              && path_contains_path (r, q)
-                              && path_contains_edge (r, e))
-                            {
-                              found = 1;
-                              break;
-                            }
-                          r = r->prev;
-                        }
+          pivot[i] = pivot[i-1];
+          (void) memcpy (basis + i*words, basis + (i-1)*words,
+                         words*sizeof (uint64_t));
+        }
+      pivot[i] = lo;
+      (void) memcpy (basis + i*words, x, words*sizeof (uint64_t));
+      ++nbasis;
 
-                      if (!found)
-                        {
-                          int size = p->ne + q->ne + 1;
-                          path_t *ring =
-                            malloc (sizeof (path_t) + size*sizeof (edge_t *));
+      /* keep the candidate itself, not its reduced form */
+      { path_t *ring = path_create (order[c].size, words);
+        (void) memcpy (ring->bits, y, words*sizeof (uint64_t));
+        ring_walk (ring, g);
+        ring->prev = tail;
+        if (tail != 0)
+          tail->next = ring;
+        else
+          g->R = ring;
+        tail = ring;
+        ++g->nr;
+      }
+    }
 
-                          ring->ne = size;
-                          ring->edges =
-                            (edge_t **)((unsigned char *)ring
-                                        + sizeof (path_t));
-                      
-                          for (j = 0; j < p->ne; ++j)
-                            ring->edges[j] = p->edges[j];
-                          for (k = 0; k < q->ne; ++k, ++j)
-                            ring->edges[j] = q->edges[k];
-                          
-                          ring->edges[j] = e;
-                          ring->next = 0;
-                          ring->prev = g->R;
-                          if (g->R != 0)
-                            g->R->next = ring;
-                          g->R = ring;
-                          
-#ifdef INCHI_DEBUG
-                          printf (" ** => new ring size %d...", ring->ne);
-#endif
-                          for (j = 0; j < ring->ne; ++j)
-                            {
-                              _inchi_vertex_set (ring->edges[j]->u, FLAG_RING);
-                              _inchi_vertex_set (ring->edges[j]->v, FLAG_RING);
-                              
-#ifdef INCHI_DEBUG
-                              printf (" [%d,%d]", ring->edges[j]->u->index,
-                                      ring->edges[j]->v->index);
-#endif
-                            }
 #ifdef INCHI_DEBUG
-                          printf ("\n");
+  { path_t *p;
+    printf ("## %d ring(s), cycle rank %d\n", g->nr, rank);
+    for (p = g->R; p != 0; p = p->next)
+      {
+        printf ("  %d:", p->ne);
+        for (i = 0; i < p->ne; ++i)
+          printf (" [%d,%d]", g->eu[p->edges[i]]+1, g->ev[p->edges[i]]+1);
+        printf ("\n");
+      }
+  }
 #endif
-                          ++g->nr;
-                        } /* !found */
-                    } /* paths overlap */
-                  
-                  next = q->next;
-                  free (q);
-                  q = next;
-                }
-              
-              next = p->next;
-              free (p);
-              p = next;
-            }
-        }
-    }
 
-  for (q = g->R; q != 0; q = q->prev)
-    g->R = q;
-  
-  free (cost);
-  free (visited);
-  
+  free (basis);
+  free (cand);
+  free (order);
+  free (scratch);
+
   return g->nr;
 }
@@ -0,0 +1,869 @@
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <math.h>
+#include <time.h>
+#include <float.h>
+
+#include "solver.h"
+#include "jacobi.h"
+#include "tridiag.h"
+
+#ifdef HAVE_GSL
+# include <gsl/gsl_eigen.h>
+# include <gsl/gsl_sort_vector.h>
+# include <gsl/gsl_version.h>
+#endif
+
+#ifdef HAVE_LAPACKE
+# include <lapacke.h>
+#endif
+
+#if !defined(HAVE_GSL) && !defined(HAVE_MKL) && !defined(HAVE_LAPACKE)
+#warning "**** Please consider using the GSL, LAPACKE or MKL eigensolver. \
+They are considerably faster than the bundled implementations! ****"
+#endif
+
+#ifdef HAVE_MKL
+# include "mkl.h" /* Intel MKL library */
+# define _XSTR(X) _STR(X)
+# define _STR(X) #X
+# define MKL_VERSION "MKL-" _XSTR(__INTEL_MKL__) "." \
+  _XSTR(__INTEL_MKL_MINOR__) "." _XSTR(__INTEL_MKL_UPDATE__)
+#endif
+
+/*
+ * graphs up to this size are handed to the built-in householder solver
+ * by the default policy, since the setup overhead of the external
+ * libraries dominates there; above it the backend of choice (see
+ * SOLVERS) is used. the built-in jacobi solver is slower than householder
+ * at every size, so it's only used when asked for by name.
+ */
+#ifndef SOLVER_SMALLG
+# define SOLVER_SMALLG 16
+#endif
+
+solver_ws_t *
+solver_ws_create ()
+{
+  solver_ws_t *ws = malloc (sizeof (solver_ws_t));
+  if (ws != 0)
+    (void) memset (ws, 0, sizeof (*ws));
+  return ws;
+}
+
+void
+solver_ws_reserve (solver_ws_t *ws, int n)
+{
+  if (ws->bsize < n)
+    {
+      ws->a = realloc (ws->a, n*n*sizeof (double));
+      ws->z = realloc (ws->z, n*n*sizeof (double));
+      ws->w = realloc (ws->w, n*sizeof (double));
+      ws->x = realloc (ws->x, n*sizeof (double));
+      ws->d = realloc (ws->d, n*sizeof (double));
+      ws->e = realloc (ws->e, n*sizeof (double));
+      ws->tau = realloc (ws->tau, n*sizeof (double));
+      ws->s = realloc (ws->s, 6*n*sizeof (double));
+      ws->rows = realloc (ws->rows, 2*n*sizeof (double *));
+      ws->bsize = n;
+    }
+}
+
+void
+solver_ws_free (solver_ws_t *ws)
+{
+  if (ws != 0)
+    {
+      if (ws->a != 0)
+        free (ws->a);
+      if (ws->z != 0)
+        free (ws->z);
+      if (ws->w != 0)
+        free (ws->w);
+      if (ws->x != 0)
+        free (ws->x);
+      if (ws->d != 0)
+        free (ws->d);
+      if (ws->e != 0)
+        free (ws->e);
+      if (ws->tau != 0)
+        free (ws->tau);
+      if (ws->s != 0)
+        free (ws->s);
+      if (ws->rows != 0)
+        free (ws->rows);
+      free (ws);
+    }
+}
+
+static void
+transpose (double *z, int n)
+{
+  int i, j;
+  double x;
+  for (i = 0; i < n; ++i)
+    for (j = i+1; j < n; ++j)
+      {
+        x = z[i*n+j];
+        z[i*n+j] = z[j*n+i];
+        z[j*n+i] = x;
+      }
+}
+
+/*
+ * jacobi always computes the eigenvectors
+ */
+static int
+jacobi_solve (solver_ws_t *ws, int n, int vectors)
+{
+  int i;
+  double **a = ws->rows, **v = ws->rows + n;
+
+  for (i = 0; i < n; ++i)
+    {
+      a[i] = ws->a + i*n;
+      v[i] = ws->z + i*n;
+    }
+
+  return jacobi (a, n, ws->w, v) < 0 ? -1 : 0;
+}
+
+static int
+jacobi_vector (solver_ws_t *ws, int n, int k, double *x)
+{
+  int i;
+  for (i = 0; i < n; ++i)
+    x[i] = ws->z[i*n+k];
+  return 0;
+}
+
+static int
+householder_solve (solver_ws_t *ws, int n, int vectors)
+{
+  int err;
+
+  if (vectors)
+    {
+      tridiag_reduce (ws->a, n, ws->w, ws->e, 1, 0);
+      (void) memcpy (ws->z, ws->a, n*n*sizeof (double));
+      transpose (ws->z, n); /* rows of z are now the columns of Q */
+      err = tridiag_ql (ws->w, ws->e, n, ws->z);
+      if (err == 0)
+        {
+          tridiag_sort (ws->w, ws->z, n);
+          transpose (ws->z, n);
+        }
+    }
+  else
+    {
+      /* keep the tridiagonal form and reflectors for householder_vector */
+      tridiag_reduce (ws->a, n, ws->d, ws->e, 0, ws->tau);
+      (void) memcpy (ws->w, ws->d, n*sizeof (double));
+      (void) memcpy (ws->s, ws->e, n*sizeof (double));
+      if ((err = tridiag_ql (ws->w, ws->s, n, 0)) == 0)
+        tridiag_sort (ws->w, 0, n);
+    }
+
+  return err;
+}
+
+static int
+householder_vector (solver_ws_t *ws, int n, int k, double *x)
+{
+  if (tridiag_vector (ws->d, ws->e, n, ws->w[k], x, ws->s) < 0)
+    return -1;
+  tridiag_apply (ws->a, ws->tau, n, x);
+  return 0;
+}
+
+/*
+ * the digest (digest_spectrum in spectral.c) only looks at eigenvalues
+ * from the first one >= SOLVER_ZERO_EPS on, as (int)(w[j]/w[i] + 0.5)
+ * in float. bisect_solve computes those integers exactly but the
+ * eigenvalues themselves only as far as it takes to decide them.
+ */
+
+static int
+quantize (double x, double l1)
+{
+  return (int)((float)x / (float)l1 + 0.5);
+}
+
+typedef struct __sturm_s {
+  const double *d; /* diagonal */
+  const double *e2; /* squared off-diagonal; e2[0] = 0 */
+  int n;
+  double pivmin, abstol;
+  double l1; /* reference eigenvalue */
+  int r; /* its index; eigenvalues up to it are exact */
+  double *w;
+} sturm_t;
+
+/*
+ * number of eigenvalues of the tridiagonal matrix less than each of
+ * x[0..2]; the three recurrences are independent so they're interleaved
+ * to hide the latency of the division that each step depends on
+ */
+static void
+sturm_count3 (const sturm_t *st, const double x[3], int c[3])
+{
+  double q0 = st->d[0] - x[0], q1 = st->d[0] - x[1], q2 = st->d[0] - x[2];
+  double pivmin = st->pivmin;
+  int i;
+
+  c[0] = c[1] = c[2] = 0;
+  for (i = 0; ; )
+    {
+      if (fabs (q0) < pivmin)
+        q0 = -pivmin;
+      if (fabs (q1) < pivmin)
+        q1 = -pivmin;
+      if (fabs (q2) < pivmin)
+        q2 = -pivmin;
+      c[0] += q0 < 0.;
+      c[1] += q1 < 0.;
+      c[2] += q2 < 0.;
+      if (++i == st->n)
+        break;
+      q0 = st->d[i] - x[0] - st->e2[i]/q0;
+      q1 = st->d[i] - x[1] - st->e2[i]/q1;
+      q2 = st->d[i] - x[2] - st->e2[i]/q2;
+    }
+}
+
+static int
+sturm_done (const sturm_t *st, double lo, double hi)
+{
+  return hi - lo <= st->abstol
+    || hi - lo <= DBL_EPSILON*(fabs (lo) + fabs (hi));
+}
+
+/*
+ * eigenvalue k in full by quadrisection of [lo, hi)
+ */
+static double
+sturm_bisect (const sturm_t *st, int k, double lo, double hi)
+{
+  double x[3], h;
+  int c[3];
+
+  while (!sturm_done (st, lo, hi))
+    {
+      h = (hi - lo)/4.;
+      x[0] = lo + h;
+      x[1] = lo + 2.*h;
+      x[2] = hi - h;
+      if (x[0] <= lo || x[2] >= hi)
+        break;
+      sturm_count3 (st, x, c);
+      if (c[0] > k)
+        hi = x[0];
+      else if (c[1] > k)
+        {
+          lo = x[0];
+          hi = x[1];
+        }
+      else if (c[2] > k)
+        {
+          lo = x[1];
+          hi = x[2];
+        }
+      else
+        lo = x[2];
+    }
+  return lo + (hi - lo)/2.;
+}
+
+/*
+ * eigenvalues lo <= w[c0..c1-1] < hi; an interval is only split while
+ * its ends quantize differently, so a cluster of eigenvalues that
+ * quantize the same is settled without being separated
+ */
+static void
+sturm_split (sturm_t *st, double lo, double hi, int c0, int c1)
+{
+  double x[5], h;
+  int i, c[5];
+
+  if (c0 >= c1)
+    return;
+
+  h = (hi - lo)/4.;
+  if (quantize (lo, st->l1) == quantize (hi, st->l1)
+      || sturm_done (st, lo, hi) || lo + h <= lo || hi - h >= hi)
+    {
+      for (i = c0; i < c1; ++i)
+        if (i > st->r || i == 0)
+          st->w[i] = lo + (hi - lo)/2.;
+      return;
+    }
+
+  x[0] = lo;
+  x[1] = lo + h;
+  x[2] = lo + 2.*h;
+  x[3] = hi - h;
+  x[4] = hi;
+  sturm_count3 (st, x+1, c+1);
+  c[0] = c0;
+  c[4] = c1;
+  for (i = 1; i < 4; ++i)
+    if (c[i] < c[i-1])
+      c[i] = c[i-1]; /* counts aren't always monotone in floating point */
+    else if (c[i] > c1)
+      c[i] = c1;
+
+  for (i = 0; i < 4; ++i)
+    sturm_split (st, x[i], x[i+1], c[i], c[i+1]);
+}
+
+/*
+ * tridiagonal bounds and tolerances for sturm_count as in dstebz
+ */
+static void
+sturm_init (sturm_t *st, solver_ws_t *ws, int n, double *gl, double *gu)
+{
+  double *e2 = ws->s, t;
+  int i;
+
+  st->d = ws->d;
+  st->e2 = e2;
+  st->n = n;
+  st->w = ws->w;
+  st->pivmin = DBL_MIN;
+  *gl = *gu = ws->d[0];
+  e2[0] = 0.;
+  for (i = 0; i < n; ++i)
+    {
+      t = (i > 0 ? fabs (ws->e[i]) : 0.) + (i+1 < n ? fabs (ws->e[i+1]) : 0.);
+      if (ws->d[i] - t < *gl)
+        *gl = ws->d[i] - t;
+      if (ws->d[i] + t > *gu)
+        *gu = ws->d[i] + t;
+      if (i > 0)
+        {
+          e2[i] = ws->e[i]*ws->e[i];
+          if (e2[i] > st->pivmin)
+            st->pivmin = e2[i];
+        }
+    }
+  st->pivmin *= DBL_MIN;
+  st->abstol = DBL_EPSILON*(fabs (*gl) > fabs (*gu) ? fabs (*gl) : fabs (*gu));
+  t = 2.*DBL_EPSILON*(fabs (*gl) + fabs (*gu)) + 2.*st->pivmin;
+  *gl -= t;
+  *gu += t;
+}
+
+/*
+ * eigenvalues to the digest's resolution: tridiagonal reduction as in
+ * householder_solve and then sturm bisection, which only narrows an
+ * eigenvalue until its quantized ratio (see above) is decided. the
+ * reference eigenvalue is exact; everything else is only good for
+ * spectral_digest.
+ */
+static int
+bisect_solve (solver_ws_t *ws, int n, int vectors)
+{
+  sturm_t st;
+  double gl, gu;
+
+  if (vectors)
+    return householder_solve (ws, n, 1);
+
+  tridiag_reduce (ws->a, n, ws->d, ws->e, 0, ws->tau);
+  if (n < 2)
+    {
+      if (n == 1)
+        ws->w[0] = ws->d[0];
+      return 0;
+    }
+
+  sturm_init (&st, ws, n, &gl, &gu);
+  for (st.r = 1; st.r < n; ++st.r)
+    {
+      ws->w[st.r] = sturm_bisect (&st, st.r, gl, gu);
+      if (ws->w[st.r] >= SOLVER_ZERO_EPS)
+        break;
+    }
+  st.l1 = st.r < n ? ws->w[st.r] : 1.;
+  sturm_split (&st, gl, gu, 0, n);
+
+  return 0;
+}
+
+/*
+ * same as householder_vector but with eigenvalue k made exact first
+ */
+static int
+bisect_vector (solver_ws_t *ws, int n, int k, double *x)
+{
+  sturm_t st;
+  double gl, gu;
+
+  if (n < 2)
+    {
+      if (n == 1)
+        x[0] = 1.;
+      return 0;
+    }
+
+  sturm_init (&st, ws, n, &gl, &gu);
+  if (tridiag_vector (ws->d, ws->e, n, sturm_bisect (&st, k, gl, gu), x,
+                      ws->s + n) < 0)
+    return -1;
+  tridiag_apply (ws->a, ws->tau, n, x);
+
+  return 0;
+}
+
+#ifdef HAVE_GSL
+static int
+gsl_solve (solver_ws_t *ws, int n, int vectors)
+{
+  int err;
+  gsl_matrix_view A = gsl_matrix_view_array (ws->a, n, n);
+  gsl_vector_view L = gsl_vector_view_array (ws->w, n);
+
+  if (vectors)
+    {
+      gsl_matrix_view V = gsl_matrix_view_array (ws->z, n, n);
+      gsl_eigen_symmv_workspace *gws = gsl_eigen_symmv_alloc (n);
+      err = gsl_eigen_symmv (&A.matrix, &L.vector, &V.matrix, gws);
+      gsl_eigen_symmv_free (gws);
+      if (err == 0)
+        gsl_eigen_symmv_sort (&L.vector, &V.matrix, GSL_EIGEN_SORT_VAL_ASC);
+    }
+  else
+    {
+      gsl_eigen_symm_workspace *gws = gsl_eigen_symm_alloc (n);
+      err = gsl_eigen_symm (&A.matrix, &L.vector, gws);
+      gsl_eigen_symm_free (gws);
+      if (err == 0)
+        gsl_sort_vector (&L.vector);
+    }
+
+  return err == 0 ? 0 : -1;
+}
+#endif /* HAVE_GSL */
+
+#ifdef HAVE_LAPACKE
+/*
+ * MRRR the way dsyevr does it, but split so that the tridiagonal
+ * reduction (dsytrd) is done once: all eigenvalues come from the
+ * root-free QL of dsterf, and an eigenvector is computed only when asked
+ * for, by index with dstemr, and then back-transformed with dormtr. a is
+ * symmetric so its row major storage is also a valid column major one.
+ */
+static int
+lapacke_solve (solver_ws_t *ws, int n, int vectors)
+{
+  lapack_int m, *isuppz, err;
+  lapack_logical tryrac = 1;
+
+  err = LAPACKE_dsytrd (LAPACK_COL_MAJOR, 'L', n, ws->a, n,
+                        ws->d, ws->e, ws->tau);
+  if (err != 0)
+    return -1;
+
+  if (!vectors)
+    {
+      (void) memcpy (ws->w, ws->d, n*sizeof (double));
+      (void) memcpy (ws->s, ws->e, n*sizeof (double));
+      return LAPACKE_dsterf (n, ws->w, ws->s) == 0 ? 0 : -1;
+    }
+
+  (void) memcpy (ws->s, ws->d, n*sizeof (double));
+  (void) memcpy (ws->s + n, ws->e, n*sizeof (double));
+  isuppz = malloc (2*n*sizeof (lapack_int));
+  err = LAPACKE_dstemr (LAPACK_COL_MAJOR, 'V', 'A', n, ws->s, ws->s + n,
+                        0., 0., 0, 0, &m, ws->w, ws->z, n, n,
+                        isuppz, &tryrac);
+  free (isuppz);
+  if (err == 0)
+    err = LAPACKE_dormtr (LAPACK_COL_MAJOR, 'L', 'L', 'N', n, n,
+                          ws->a, n, ws->tau, ws->z, n);
+  if (err == 0)
+    transpose (ws->z, n); /* column k is now eigenvector k */
+
+  return err == 0 ? 0 : -1;
+}
+
+static int
+lapacke_vector (solver_ws_t *ws, int n, int k, double *x)
+{
+  lapack_int m, isuppz[2], err;
+  lapack_logical tryrac = 1;
+  double *d = ws->s, *e = ws->s + n, *w = ws->s + 2*n;
+
+  /* dstemr destroys the tridiagonal matrix and wants w of size n */
+  (void) memcpy (d, ws->d, n*sizeof (double));
+  (void) memcpy (e, ws->e, n*sizeof (double));
+  err = LAPACKE_dstemr (LAPACK_COL_MAJOR, 'V', 'I', n, d, e,
+                        0., 0., k+1, k+1, &m, w, x, n, 1,
+                        isuppz, &tryrac);
+  if (err == 0)
+    err = LAPACKE_dormtr (LAPACK_COL_MAJOR, 'L', 'L', 'N', n, 1,
+                          ws->a, n, ws->tau, x, n);
+
+  return err == 0 ? 0 : -1;
+}
+#endif /* HAVE_LAPACKE */
+
+#ifdef HAVE_MKL
+static int
+mkl_solve (solver_ws_t *ws, int n, int vectors)
+{
+  int err = LAPACKE_dsyevd (LAPACK_ROW_MAJOR, vectors ? 'V' : 'N', 'U',
+                            n, ws->a, n, ws->w);
+  if (err == 0 && vectors)
+    {
+      /* the eigenvectors overwrite a */
+      double *z = ws->z;
+      ws->z = ws->a;
+      ws->a = z;
+    }
+  return err == 0 ? 0 : -1;
+}
+#endif /* HAVE_MKL */
+
+/*
+ * all compiled-in solvers; the last exact one is what the default policy
+ * uses for anything but small graphs
+ */
+static const solver_t SOLVERS[] = {
+  {"jacobi", "Built-in Jacobi solver", jacobi_solve, jacobi_vector},
+  {"householder", "Built-in Householder/QL solver", householder_solve,
+   householder_vector},
+  {"bisect", "Built-in bisection solver (digest precision)", bisect_solve,
+   bisect_vector, 1},
+#ifdef HAVE_GSL
+  {"gsl", "GSL-" GSL_VERSION, gsl_solve, 0},
+#endif
+#ifdef HAVE_LAPACKE
+  {"lapacke", "LAPACKE (MRRR)", lapacke_solve, lapacke_vector},
+#endif
+#ifdef HAVE_MKL
+  {"mkl", MKL_VERSION, mkl_solve, 0},
+#endif
+};
+
+#define SOLVER_COUNT (sizeof (SOLVERS) / sizeof (SOLVERS[0]))
+
+int
+solver_fiedler (const solver_t *s, solver_ws_t *ws, int n, double eps)
+{
+  int i, k;
+
+  if ((*s->solve) (ws, n, s->vector == 0) < 0)
+    return -1;
+
+  for (k = 1; k < n-1 && ws->w[k] < eps; ++k)
+    ;
+  if (k >= n)
+    k = 0;
+
+  if (s->vector != 0)
+    return (*s->vector) (ws, n, k, ws->x) < 0 ? -1 : k;
+
+  for (i = 0; i < n; ++i)
+    ws->x[i] = ws->z[i*n+k];
+
+  return k;
+}
+
+const solver_t *
+solver_get (int i)
+{
+  return i >= 0 && i < SOLVER_COUNT ? &SOLVERS[i] : 0;
+}
+
+const solver_t *
+solver_lookup (const char *name)
+{
+  int i;
+  for (i = 0; i < SOLVER_COUNT; ++i)
+    if (strcmp (SOLVERS[i].name, name) == 0)
+      return &SOLVERS[i];
+  return 0;
+}
+
+/* the last solver in SOLVERS with exact eigenvalues */
+static const solver_t *
+solver_backend ()
+{
+  int i = SOLVER_COUNT-1;
+  while (i > 0 && SOLVERS[i].approx)
+    --i;
+  return &SOLVERS[i];
+}
+
+void
+solver_policy_default (solver_policy_t *policy, int maxg)
+{
+  policy->count = 0;
+  policy->size[policy->count] = SOLVER_SMALLG;
+  policy->solver[policy->count++] = solver_lookup ("householder");
+  policy->size[policy->count] = maxg;
+  policy->solver[policy->count++] = solver_backend ();
+}
+
+const solver_t *
+solver_select (const solver_policy_t *policy, int n)
+{
+  int i;
+  for (i = 0; i < policy->count; ++i)
+    if (n <= policy->size[i])
+      return policy->solver[i];
+  /* larger than anything in the policy; use the last one */
+  return policy->count > 0 ? policy->solver[policy->count-1]
+    : solver_backend ();
+}
+
+int
+solver_policy_load (solver_policy_t *policy, const char *file, int maxg)
+{
+  char line[BUFSIZ], name[BUFSIZ];
+  int size, count = 0, lineno = 0;
+  solver_policy_t p;
+  FILE *fp = fopen (file, "r");
+
+  if (fp == 0)
+    return -1;
+
+  while (fgets (line, sizeof (line), fp) != 0)
+    {
+      const solver_t *s;
+      char *ptr = line;
+
+      ++lineno;
+      while (isspace (*ptr))
+        ++ptr;
+      if (*ptr == '#' || *ptr == '\0')
+        continue;
+
+      if (sscanf (ptr, "%d %s", &size, name) != 2 || size < 1)
+        {
+          fprintf (stderr, "** warning: %s:%d: malformed line ignored **\n",
+                   file, lineno);
+          continue;
+        }
+
+      /* e.g., a profile written by a gsl build read by a plain build */
+      if ((s = solver_lookup (name)) == 0)
+        {
+          fprintf (stderr, "** warning: %s:%d: solver '%s' isn't available; "
+                   "ignored **\n", file, lineno, name);
+          continue;
+        }
+
+      /* approximate solvers are only ever used when forced by name */
+      if (s->approx)
+        {
+          fprintf (stderr, "** warning: %s:%d: solver '%s' is only accurate "
+                   "to digest precision; ignored **\n", file, lineno, name);
+          continue;
+        }
+
+      if (count == SOLVER_POLICY_MAX
+          || (count > 0 && size <= p.size[count-1]))
+        {
+          fprintf (stderr, "** warning: %s:%d: entry out of order or too "
+                   "many entries; ignored **\n", file, lineno);
+          continue;
+        }
+      p.size[count] = size;
+      p.solver[count++] = s;
+    }
+  (void) fclose (fp);
+
+  if (count == 0)
+    return -1;
+
+  /* make sure the last entry covers everything */
+  if (p.size[count-1] < maxg)
+    p.size[count-1] = maxg;
+  p.count = count;
+  *policy = p;
+
+  return 0;
+}
+
+int
+solver_policy_save (const solver_policy_t *policy, const char *file)
+{
+  int i;
+  FILE *fp = fopen (file, "w");
+  if (fp == 0)
+    return -1;
+
+  fprintf (fp, "# eigensolver tuning profile (written by --tune)\n"
+           "# <largest graph size> <solver>\n");
+  for (i = 0; i < policy->count; ++i)
+    fprintf (fp, "%d %s\n", policy->size[i], policy->solver[i]->name);
+
+  return fclose (fp) == 0 ? 0 : -1;
+}
+
+/*
+ * deterministic generator so calibration runs are comparable
+ */
+static unsigned
+tune_rand (unsigned *seed)
+{
+  *seed = *seed * 1103515245u + 12345u;
+  return (*seed >> 16) & 0x7fff;
+}
+
+/*
+ * normalized laplacian of a random molecule-like graph: a spanning tree
+ * with degree at most 4 plus about one ring closure per six atoms
+ */
+static void
+tune_graph (double *a, int n, unsigned *seed)
+{
+  int i, j, k, *d = malloc (n * sizeof (int));
+
+  (void) memset (a, 0, n*n*sizeof (double));
+  (void) memset (d, 0, n*sizeof (int));
+  for (i = 1; i < n; ++i)
+    {
+      do
+        j = tune_rand (seed) % i;
+      while (d[j] >= 4);
+      a[i*n+j] = a[j*n+i] = 1.;
+      ++d[i];
+      ++d[j];
+    }
+
+  for (k = 0; k < n/6; ++k)
+    {
+      i = tune_rand (seed) % n;
+      j = tune_rand (seed) % n;
+      if (i != j && d[i] < 3 && d[j] < 3 && a[i*n+j] == 0.)
+        {
+          a[i*n+j] = a[j*n+i] = 1.;
+          ++d[i];
+          ++d[j];
+        }
+    }
+
+  for (i = 0; i < n; ++i)
+    {
+      for (j = 0; j < n; ++j)
+        if (a[i*n+j] != 0.)
+          a[i*n+j] = -1./sqrt (d[i]*d[j]);
+      a[i*n+i] = 1.;
+    }
+  free (d);
+}
+
+/*
+ * average time (in seconds) of solver s over a few graphs of size n
+ */
+static double
+tune_time (const solver_t *s, solver_ws_t *ws, double *m, int n, int vectors)
+{
+  struct timespec t0, t1;
+  double t = 0.;
+  int reps = 0;
+
+  /* warm up */
+  (void) memcpy (ws->a, m, n*n*sizeof (double));
+  (void) (*s->solve) (ws, n, 0);
+  do
+    {
+      (void) memcpy (ws->a, m + (reps % 4)*n*n, n*n*sizeof (double));
+      (void) clock_gettime (CLOCK_MONOTONIC, &t0);
+      if (vectors)
+        (void) solver_fiedler (s, ws, n, 1e-20);
+      else
+        (void) (*s->solve) (ws, n, 0);
+      (void) clock_gettime (CLOCK_MONOTONIC, &t1);
+      t += (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec)*1e-9;
+    }
+  while (++reps < 3 || (t < 2e-3 && reps < 1000));
+
+  return t / reps;
+}
+
+int
+solver_tune (solver_policy_t *policy, int maxg, int vectors, FILE *log)
+{
+  static const int SIZES[] = {
+    4, 6, 8, 12, 16, 24, 32, 48, 64, 96, 128, 192, 256, 384, 512
+  };
+  double best[SOLVER_COUNT], *m = 0;
+  int active[SOLVER_COUNT];
+  int i, j, k, n, count = 0;
+  unsigned seed = 20130322u;
+  solver_ws_t *ws = solver_ws_create ();
+  solver_policy_t p;
+
+  /* approximate solvers aren't a drop-in replacement for the others */
+  for (j = 0; j < SOLVER_COUNT; ++j)
+    active[j] = !SOLVERS[j].approx;
+
+  for (i = 0; i < sizeof (SIZES)/sizeof (SIZES[0]) && SIZES[i] <= maxg; ++i)
+    {
+      const solver_t *winner = 0;
+      double tmin = 0.;
+
+      n = SIZES[i];
+      solver_ws_reserve (ws, n);
+      m = realloc (m, 4*n*n*sizeof (double));
+      for (k = 0; k < 4; ++k)
+        tune_graph (m + k*n*n, n, &seed);
+
+      if (log != 0)
+        fprintf (log, "%4d:", n);
+      for (j = 0; j < SOLVER_COUNT; ++j)
+        {
+          if (!active[j])
+            continue;
+          best[j] = tune_time (&SOLVERS[j], ws, m, n, vectors);
+          if (log != 0)
+            fprintf (log, " %s=%.1fus", SOLVERS[j].name, best[j]*1e6);
+          if (winner == 0 || best[j] < tmin)
+            {
+              winner = &SOLVERS[j];
+              tmin = best[j];
+            }
+        }
+      if (log != 0)
+        fprintf (log, " => %s\n", winner->name);
+
+      /* don't bother with solvers that have fallen way behind */
+      for (j = k = 0; j < SOLVER_COUNT; ++j)
+        if (active[j] && best[j] > 4.*tmin)
+          active[j] = 0;
+        else
+          k += active[j];
+
+      if (count > 0 && p.solver[count-1] == winner)
+        p.size[count-1] = n;
+      else if (count < SOLVER_POLICY_MAX)
+        {
+          p.size[count] = n;
+          p.solver[count++] = winner;
+        }
+
+      /* keep it short; nothing left to decide or it's getting slow */
+      if (k < 2 || tmin > 50e-3)
+        break;
+    }
+
+  if (count > 0)
+    {
+      p.size[count-1] = maxg; /* last winner takes everything above */
+      p.count = count;
+      *policy = p;
+    }
+
+  if (m != 0)
+    free (m);
+  solver_ws_free (ws);
+
+  return count > 0 ? 0 : -1;
+}
@@ -0,0 +1,115 @@
+
+#ifndef __solver_h__
+#define __solver_h__
+
+#include <stddef.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Eigensolver backends for the (dense) real symmetric matrices assembled
+ * by spectral.c. Every backend that is available at compile time is
+ * linked in; which one is used for a given matrix is decided at runtime
+ * by a size based policy (or forced by name).
+ */
+
+/*
+ * workspace shared by all backends; buffers are grown but never shrunk
+ */
+typedef struct __solver_ws_s {
+  size_t bsize; /* allocated dimension */
+  double *a; /* n x n row major input matrix; destroyed by the solver */
+  double *w; /* eigenvalues in ascending order */
+  double *z; /* n x n eigenvectors; column k is the eigenvector of w[k] */
+  double *x; /* a single eigenvector of size n (see solver_fiedler) */
+  double *d; /* tridiagonal form: diagonal */
+  double *e; /* tridiagonal form: off-diagonal (or scratch) of size n */
+  double *tau; /* scalar factors of the elementary reflectors */
+  double *s; /* scratch of size 6*n */
+  double **rows; /* scratch of 2*n row pointers */
+} solver_ws_t;
+
+typedef struct __solver_s {
+  const char *name;
+  const char *version;
+  /*
+   * eigenvalues of ws->a into ws->w and, if vectors is nonzero, the
+   * eigenvectors into ws->z; returns 0 on success or < 0 on failure
+   */
+  int (*solve) (solver_ws_t *ws, int n, int vectors);
+  /*
+   * optional; eigenvector k into x following solve (ws, n, 0) on the same
+   * workspace. solvers that provide this keep whatever factorization they
+   * need in ws so a single eigenvector doesn't cost all n of them
+   */
+  int (*vector) (solver_ws_t *ws, int n, int k, double *x);
+  /*
+   * nonzero if solve (ws, n, 0) only gets the eigenvalues right as far as
+   * spectral_digest is concerned; such a solver is only used by name
+   */
+  int approx;
+} solver_t;
+
+/*
+ * computed eigenvalues below this are taken to be 0: they're returned as
+ * 0 and the digest's reference eigenvalue (the one every other is
+ * divided by) is the first one at or above it
+ */
+#define SOLVER_ZERO_EPS 1e-10
+
+/*
+ * size based policy; solver[i] is used for graphs with at most size[i]
+ * vertices. entries are in increasing order of size
+ */
+#define SOLVER_POLICY_MAX 8
+typedef struct __solver_policy_s {
+  int count;
+  int size[SOLVER_POLICY_MAX];
+  const solver_t *solver[SOLVER_POLICY_MAX];
+} solver_policy_t;
+
+extern solver_ws_t *solver_ws_create ();
+extern void solver_ws_reserve (solver_ws_t *ws, int n);
+extern void solver_ws_free (solver_ws_t *ws);
+
+/*
+ * eigenvalues of ws->a into ws->w and the eigenvector of the smallest
+ * eigenvalue > eps into ws->x; returns its index or < 0 on failure
+ */
+extern int solver_fiedler (const solver_t *s, solver_ws_t *ws,
+                           int n, double eps);
+
+/* i-th compiled-in solver or 0 if i is out of range */
+extern const solver_t *solver_get (int i);
+extern const solver_t *solver_lookup (const char *name);
+
+extern void solver_policy_default (solver_policy_t *policy, int maxg);
+extern const solver_t *solver_select (const solver_policy_t *policy, int n);
+
+/*
+ * a profile is a text file with one "<largest graph size> <solver>" entry
+ * per line in increasing order of size; '#' starts a comment. entries
+ * naming an approximate solver (or one that isn't compiled in) are
+ * skipped with a warning. load returns -1 (leaving policy untouched) if
+ * file can't be read or has no usable entry.
+ */
+extern int solver_policy_load (solver_policy_t *policy,
+                               const char *file, int maxg);
+extern int solver_policy_save (const solver_policy_t *policy,
+                               const char *file);
+
+/*
+ * time every compiled-in solver on random molecule-like graphs of
+ * increasing size and set policy to the fastest solver for each size
+ * range; progress is written to log (if not null)
+ */
+extern int solver_tune (solver_policy_t *policy, int maxg,
+                        int vectors, FILE *log);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* __solver_h__ */
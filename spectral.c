@@ -15,28 +15,9 @@
  */
 #define __SPECTRAL_VERSION "v0.1"
 
-#ifdef HAVE_GSL
-# include <gsl/gsl_eigen.h>
-# include <gsl/gsl_version.h>
-# define SPECTRAL_VERSION __SPECTRAL_VERSION " (GSL-" GSL_VERSION ")"
-#elif defined(HAVE_MKL)
-# include "mkl.h" /* Intel MKL library */
-# define _XSTR(X) _STR(X)
-# define _STR(X) #X
-# define SPECTRAL_VERSION __SPECTRAL_VERSION \
-  " (MKL-" _XSTR(__INTEL_MKL__) "." _XSTR(__INTEL_MKL_MINOR__) \
-  "." _XSTR(__INTEL_MKL_UPDATE__) ")"
-#else
-#warning "**** Please consider using either the GSL or MKL eigensolver. \
-They are orders of magnitude faster! The bundled implementation is only \
-for completeness sake. ****"
-# include "jacobi.h"
-# define SPECTRAL_VERSION __SPECTRAL_VERSION " (Built-in Jacobi solver)"
-#endif
-
-#ifndef EPS
-# define EPS 1e-20
-#endif
+#include "solver.h"
+#include "lanczos.h"
+#include "cpoly.h"
 
 
 /*
@@ -44,12 +25,63 @@ for completeness sake. ****"
  * (e.g., iterative ones) are more appropriate.
  */
 #ifndef SPECTRAL_MAXG
-# define SPECTRAL_MAXG 5000
+# define SPECTRAL_MAXG INCHI_MAXV
 #endif
 
 #define __set_edge(i,j) G[(i)*size+(j)] = G[(j)*size+(i)] = 1
 #define __get_edge(i,j) G[(i)*size+(j)]
 
+/*
+ * spectral_ratio uses lanczos for graphs larger than this; the smallest
+ * non-zero eigenvalue of molecular graphs sits in a cluster near 0, so
+ * lanczos needs about n/2 steps and only pays off for large graphs
+ */
+#ifndef SPECTRAL_LANCZOSG
+# define SPECTRAL_LANCZOSG 256
+#endif
+
+/*
+ * computed eigenvalues below this are taken to be 0 by spectral_ratio;
+ * well below the smallest non-zero eigenvalue of any graph of at most
+ * SPECTRAL_LANCZOSG vertices (O(1/n^2), e.g., 7.6e-5 for a path)
+ */
+#ifndef NULL_EPS
+# define NULL_EPS 1e-10
+#endif
+
+/*
+ * eigenvectors of a bipartite graph are unfolded from those of B B' by
+ * dividing by the singular value; below this it's the full solve instead
+ */
+#ifndef BIPARTITE_EPS
+# define BIPARTITE_EPS 1e-8
+#endif
+
+/*
+ * a graph whose equitable partition has r < n cells is solved as an r x r
+ * quotient and an (n-r) x (n-r) complement block if the larger of the two
+ * is at most this fraction of n; 0 turns the split off
+ */
+#ifndef SPECTRAL_EQUITABLE
+# define SPECTRAL_EQUITABLE .75
+#endif
+
+/*
+ * spectral_spectra solves its matrices concurrently (when built with
+ * OpenMP) for graphs of at least this many vertices; below that the
+ * threads cost more than the eigensolves
+ */
+#ifndef SPECTRAL_PARALLELG
+# define SPECTRAL_PARALLELG 96
+#endif
+
+/*
+ * tuning profile written by spectral_tune and read by spectral_create
+ */
+#ifndef SPECTRAL_PROFILE
+# define SPECTRAL_PROFILE ".spectral_profile" /* relative to $HOME */
+#endif
+
 /**
  * internal state of spectral_t
  */
@@ -58,9 +90,40 @@ struct __spectral_s
   size_t bsize; /* buffer size of spectrum */
   size_t size; /* actual size of spectrum! */
   float *spectrum; /* spectrum buffer */
-  float *fiedler; /* fiedler vector */
+  float *vector; /* last eigenvector asked for (see spectral_vector) */
+  int vector_k; /* its index or -1 if it's not been computed */
+  int fiedler_k; /* index of the fiedler vector */
+  int vectors; /* order of the matrix whose eigenvectors ws->z holds (or 0) */
+  int weighted; /* nonzero if the last graph was solved with bond weights */
+  int bipartite; /* p if the last graph was solved as bipartite (or 0) */
+  int *side; /* side of each vertex of a bipartite graph; 0 has p vertices */
+  double *sigma; /* singular values of its biadjacency block (ascending) */
+  int equitable; /* cells if the last graph was split by its partition */
+  int esize; /* allocated order of eq */
+  double *eq; /* n x n scratch for the split */
   sha1_t *sha1; /* sha1 hash */
   inchi_t *inchi;
+  solver_ws_t *ws; /* eigensolver workspace */
+  solver_policy_t policy; /* size based solver selection */
+  const solver_t *solver; /* forced solver (if not null) */
+  const solver_t *used; /* solver used for the last graph */
+  lanczos_t *lz; /* for spectral_ratio */
+  cpoly_t *cp; /* for spectral_digest_exact */
+  int msize; /* allocated order of the spectra of spectral_spectra */
+  solver_ws_t *mws[SPECTRAL_TYPES]; /* workspace of each matrix type */
+  float *mspectrum[SPECTRAL_TYPES]; /* spectrum of each matrix type */
+  int ssize; /* allocated vertices of the sparse form */
+  int nsize; /* allocated nonzeros of the sparse form */
+  int *sp_p, *sp_j; /* sparse normalized laplacian (CSR) */
+  double *sp_v;
+  int *comp; /* connected component of each vertex (-1 if isolated) */
+  double *null; /* null vector D^{1/2}1 of each component */
+  int csize; /* allocated sections of spectral_components */
+  spectral_component_t *component; /* of the last spectral_components */
+  char *ckey; /* their hashkeys, 31 chars each */
+  solver_ws_t **cws; /* workspace of each */
+  int cvsize; /* allocated vertices of cspectrum */
+  float *cspectrum; /* their spectra, one after the other */
   unsigned char digest[20]; /* digest buffer */
   char hashkey[31]; /* 9(topology) + 10(connection) + 11(full) */
   char errmsg[BUFSIZ];
@@ -68,14 +131,14 @@ struct __spectral_s
 
 
 static void
-digest_spectrum (spectral_t *sp, int size)
+digest_spectrum (spectral_t *sp, const float *spectrum, int size)
 {
   unsigned char data[2];
   unsigned int uv;
   int i = 0, j;
 
   /* skip over all disconnected components */
-  while (i < size && sp->spectrum[++i] < EPS)
+  while (i < size && spectrum[++i] <= 0.f) /* see spectrum_value */
     ;
 
 #ifdef SPECTRAL_DEBUG
@@ -84,7 +147,7 @@ digest_spectrum (spectral_t *sp, int size)
 
   for (j = i; j < size; ++j)
     {
-      uv = (int)(sp->spectrum[j] / sp->spectrum[i] + 0.5);
+      uv = (int)(spectrum[j] / spectrum[i] + 0.5);
 #ifdef SPECTRAL_DEBUG
       printf (" %u", uv);
 #endif
@@ -98,9 +161,9 @@ digest_spectrum (spectral_t *sp, int size)
   printf ("\neigenvalues:\n");
   for (j = i; j < size; ++j)
     {
-      uv = (int)(sp->spectrum[j] / sp->spectrum[i] + 0.5);
-      x = sp->spectrum[j] < 1. ? 1. - sp->spectrum[j] : sp->spectrum[j] - 1.;
-      printf ("%3d: %.10f => %3u\n", j, sp->spectrum[j], uv);
+      uv = (int)(spectrum[j] / spectrum[i] + 0.5);
+      x = spectrum[j] < 1. ? 1. - spectrum[j] : spectrum[j] - 1.;
+      printf ("%3d: %.10f => %3u\n", j, spectrum[j], uv);
     }
   }
 #endif
@@ -195,368 +258,1205 @@ spectral_normalized_graph (double **M, const int *G, int nv, size_t size)
   free (d);
 }
 
-#ifdef HAVE_GSL
+/*
+ * same as spectral_normalized_graph but from the adjacency lists
+ * j[p[i]..p[i+1]-1] into a contiguous row major buffer; only vertices
+ * first..first+nv-1, which mustn't have neighbors outside of them
+ */
+static void
+normalized_matrix (double *a, const int *p, const int *j, int first, int nv)
+{
+  int i, q, u;
+
+  (void) memset (a, 0, (size_t)nv*nv*sizeof (double));
+  for (i = 0, u = first; i < nv; ++i, ++u)
+    {
+      a[i*nv+i] = 1;
+      for (q = p[u]; q < p[u+1]; ++q)
+        a[i*nv+j[q]-first] = -1./sqrt ((p[u+1]-p[u])*(p[j[q]+1]-p[j[q]]));
+    }
+}
+
+#ifdef __GNUC__
+# define bits_ctz(x) __builtin_ctzll (x)
+# define bits_count(x) __builtin_popcountll (x)
+#else
 static int
-graph_spectrum (float *spectrum, float *fiedler, const inchi_t *g)
+bits_ctz (uint64_t x)
 {
-  int i, j, v, *d, nv = inchi_node_count (g);
-  double x;
-  const int *G = inchi_matrix_A (g);
-  size_t size = inchi_matrix_size (g);
-  gsl_eigen_symmv_workspace *ws = gsl_eigen_symmv_alloc (nv);
-  gsl_matrix *A = gsl_matrix_alloc (nv, nv);
-  gsl_matrix *V = gsl_matrix_alloc (nv, nv);
-  gsl_vector *L = gsl_vector_alloc (nv);
+  int k = 0;
+  for (; !(x & 1); x >>= 1)
+    ++k;
+  return k;
+}
 
-#ifdef SPECTRAL_DEBUG
-  gsl_matrix *D = gsl_matrix_alloc (nv, nv);
+static int
+bits_count (uint64_t x)
+{
+  int k = 0;
+  for (; x != 0; x &= x-1)
+    ++k;
+  return k;
+}
 #endif
-  
-  /* 
-   * normalized laplacian matrix
-   */
-  d = malloc (nv *sizeof (int));
+
+#define BITS_WORDS (INCHI_BITS_MAXG/64)
+
+/*
+ * 2-coloring of g by breadth first search of each component from its
+ * first vertex, a whole level at a time on the bitset rows: the next
+ * level is the union of the rows of this one and there's an odd cycle
+ * if it meets the side this one is on. returns the size of side 0 or -1
+ * if there's an odd cycle
+ */
+static int
+bipartite_bits (spectral_t *sp, const uint64_t *bits, int words, int nv)
+{
+  uint64_t seen[BITS_WORDS] = {0}, side[2][BITS_WORDS] = {{0}};
+  uint64_t level[BITS_WORDS], next[BITS_WORDS], any, x;
+  int i, k, w, s, p = 0;
+
   for (i = 0; i < nv; ++i)
-    {
-      d[i] = 0;
-      for (j = 0; j < nv; ++j)
-        if (i != j)
+    if (!(seen[i/64] & ((uint64_t)1 << (i%64))))
+      {
+        for (w = 0, any = 0; w < words; ++w)
+          any |= bits[i*words+w];
+        if (any == 0)
           {
-            v = __get_edge (i+1, j+1);
-            d[i] += v;
-#ifdef SPECTRAL_DEBUG
-            if (v)
+            /* isolated */
+            side[0][i/64] |= (uint64_t)1 << (i%64);
+            continue;
+          }
+
+        for (w = 0; w < words; ++w)
+          level[w] = 0;
+        level[i/64] = (uint64_t)1 << (i%64);
+        seen[i/64] |= level[i/64];
+        for (s = 0, any = 1; any != 0; s = !s)
+          {
+            for (w = 0; w < words; ++w)
+              next[w] = 0;
+            for (w = 0; w < words; ++w)
+              for (x = level[w]; x != 0; x &= x-1)
+                {
+                  const uint64_t *row = bits + (64*w + bits_ctz (x))*words;
+                  for (k = 0; k < words; ++k)
+                    next[k] |= row[k];
+                }
+            for (w = 0, any = 0; w < words; ++w)
               {
-                gsl_matrix_set (D, i, j, 1.);
-                gsl_matrix_set (D, j, i, 1.);
+                side[s][w] |= level[w];
+                if (next[w] & side[s][w])
+                  return -1; /* odd cycle */
+                level[w] = next[w] & ~seen[w];
+                seen[w] |= level[w];
+                any |= level[w];
               }
-#endif
           }
+      }
 
-      gsl_matrix_set (A, i, i, 1);
-      for (j = 0; j < i; ++j)
-        {
-          x = __get_edge (j+1, i+1) ? -1./sqrt (d[i]*d[j]) : 0.;
-          gsl_matrix_set (A, i, j, x);
-          gsl_matrix_set (A, j, i, x);
-        }
-    }
-  free (d);
-
-#ifdef SPECTRAL_DEBUG
-#if 0
-  printf ("G = \n");
   for (i = 0; i < nv; ++i)
+    sp->side[i] = (side[1][i/64] >> (i%64)) & 1;
+  for (w = 0; w < words; ++w)
+    p += bits_count (side[0][w]);
+  return p;
+}
+
+/*
+ * side of each vertex of g into sp->side, the smaller one (p vertices,
+ * which is returned) being 0, if g is bipartite; otherwise -1. graphs
+ * with bitset rows take bipartite_bits, larger ones a breadth first
+ * search of the adjacency lists
+ */
+static int
+bipartite_sides (spectral_t *sp, const inchi_t *g)
+{
+  int i, j, q, u, head, tail, words, p = 0, nv = inchi_node_count (g);
+  const int *aj, *ap = inchi_adjacency (g, &aj);
+  const uint64_t *bits = inchi_adjacency_bits (g, &words);
+  int *queue;
+
+  if (bits != 0)
+    p = bipartite_bits (sp, bits, words, nv);
+  else
     {
-      for (j = 0; j < nv; ++j)
-        printf (" %-4.5f", gsl_matrix_get (A, i, j));
-      printf ("\n");
+      queue = malloc (nv*sizeof (int));
+      for (i = 0; i < nv; ++i)
+        sp->side[i] = -1;
+
+      for (i = 0; i < nv && p >= 0; ++i)
+        if (sp->side[i] < 0)
+          {
+            sp->side[i] = 0;
+            queue[0] = i;
+            for (head = 0, tail = 1; head < tail && p >= 0; ++head)
+              {
+                u = queue[head];
+                for (q = ap[u]; q < ap[u+1]; ++q)
+                  {
+                    j = aj[q];
+                    if (sp->side[j] < 0)
+                      {
+                        sp->side[j] = !sp->side[u];
+                        queue[tail++] = j;
+                      }
+                    else if (sp->side[j] == sp->side[u])
+                      {
+                        p = -1; /* odd cycle */
+                        break;
+                      }
+                  }
+              }
+          }
+      free (queue);
+
+      for (i = 0; i < nv && p >= 0; ++i)
+        p += sp->side[i] == 0;
     }
-#else
-  printf ("A = [");
-  for (i = 0; i < nv; ++i)
-    {
-      for (j = 0; j < nv; ++j)
-        printf (" %-2.0f", gsl_matrix_get (D, i, j));
-      printf (";\n");
-    }  
-  printf ("];\n");
-  gsl_matrix_free (D);
-  
-  printf ("G = [");
-  for (i = 0; i < nv; ++i)
+
+  if (2*p > nv)
     {
-      for (j = 0; j < nv; ++j)
-        printf (" %-4.5f", gsl_matrix_get (A, i, j));
-      printf (";\n");
+      for (i = 0; i < nv; ++i)
+        sp->side[i] = !sp->side[i];
+      p = nv - p;
     }
-  printf ("];\n");
-#endif
-#endif
-  
-  gsl_eigen_symmv (A, L, V, ws);
-  gsl_eigen_symmv_sort (L, V, GSL_EIGEN_SORT_VAL_ASC);
+  return p;
+}
 
-  i = 0;
-  while (i < nv && gsl_vector_get (L, ++i) < EPS)
-    ;
-#ifdef SPECTRAL_DEBUG  
-  printf ("Eigenvector of the smallest, non-zero eigenvalue (%d: %.5f):\n",
-          i, gsl_vector_get (L, i));
-#endif
+/*
+ * for a bipartite graph the normalized laplacian is I - [0 B; B' 0] (up
+ * to a permutation) with B the p x q normalized biadjacency block between
+ * the smaller and the larger side. its eigenvalues are 1 +/- the singular
+ * values of B plus q-p 1s, so only the p x p matrix B B' needs to be
+ * decomposed, which is about 8 times less work. if g is bipartite and
+ * has an edge, B B' goes into a, the side of each vertex into sp->side
+ * and p is returned; otherwise 0.
+ */
+static int
+bipartite_matrix (spectral_t *sp, double *a, const inchi_t *g)
+{
+  int i, j, k, u, q, p, *index, *queue, nv = inchi_node_count (g);
+  const int *aj, *ap = inchi_adjacency (g, &aj);
+  double *bv;
 
-#ifdef SPECTRAL_DEBUG
-  { gsl_vector_view ev1 = gsl_matrix_column (V, i);
-    gsl_vector_view ev2 = gsl_matrix_column (V, i+1);
-    gsl_vector_view ev3 = gsl_matrix_column (V, i+2);    
-    for (i = 0; i < nv; ++i)
-      {
-        printf ("% 3d: % 11.10f\n", i, gsl_vector_get (&ev1.vector, i));
-        fiedler[i] = gsl_vector_get (&ev1.vector, i);
-      }
+  p = bipartite_sides (sp, g);
+  if (p <= 0)
+    return 0;
 
-    printf ("Eigenvectors of next two smallest eigenvalues\n");
-    printf ("v = [\n");
-    for (i = 0; i < nv; ++i)
+  index = malloc (2*nv*sizeof (int));
+  queue = index + nv;
+  for (i = 0, j = 0, k = 0; i < nv; ++i)
+    index[i] = sp->side[i] == 0 ? j++ : k++;
+
+  for (i = 0; i < p*p; ++i)
+    a[i] = 0.;
+
+  /* B B' one column of B (i.e., vertex of the larger side) at a time */
+  bv = malloc (nv*sizeof (double));
+  for (u = 0; u < nv; ++u)
+    if (sp->side[u] != 0)
       {
-        printf ("%.10f %.10f;\n", gsl_vector_get (&ev2.vector, i),
-                gsl_vector_get (&ev3.vector, i));
+        for (q = ap[u], k = 0; q < ap[u+1]; ++q)
+          {
+            i = aj[q];
+            queue[k] = index[i];
+            bv[k++] = 1./sqrt ((ap[i+1]-ap[i])*(ap[u+1]-ap[u]));
+          }
+        for (i = 0; i < k; ++i)
+          for (j = 0; j < k; ++j)
+            a[queue[i]*p+queue[j]] += bv[i]*bv[j];
       }
-    printf ("];\n");
-  }
-#else
-  { gsl_vector_view ev = gsl_matrix_column (V, i);
-    for (i = 0; i < nv; ++i)
-        fiedler[i] = gsl_vector_get (&ev.vector, i);
-  }
-#endif
-  
-  for (i = 0; i < nv; ++i)
-    spectrum[i] = gsl_vector_get (L, i);
-    
-  gsl_vector_free (L);
-  gsl_matrix_free (V);
-  gsl_matrix_free (A);
-  gsl_eigen_symmv_free (ws);
-
-  return 0;
+  free (bv);
+  free (index);
+  return p;
 }
 
-#elif defined(HAVE_MKL)
+/*
+ * the eigenvalues of B B' in ws->w into sp->sigma and the full spectrum
+ * of the graph back into ws->w
+ */
+static void
+bipartite_unfold (spectral_t *sp, int n)
+{
+  int i, p = sp->bipartite;
+  double *w = sp->ws->w;
+
+  for (i = 0; i < p; ++i)
+    sp->sigma[i] = w[i] > 0. ? sqrt (w[i]) : 0.;
+  for (i = 0; i < p; ++i)
+    {
+      w[i] = 1. - sp->sigma[p-1-i];
+      w[n-1-i] = 1. + sp->sigma[p-1-i];
+    }
+  for (i = p; i < n-p; ++i)
+    w[i] = 1.;
+}
 
+/*
+ * eigenvector k of the bipartite graph last solved by graph_spectrum:
+ * for eigenvalue 1 -/+ sigma with u the eigenvector of B B', it's u on
+ * the smaller side and +/- B'u/sigma on the other (over sqrt 2). the
+ * eigenvalue 1 (and sigma too small to divide by) has no such partner
+ * and takes a solve of the whole graph.
+ */
 static int
-graph_spectrum (float *spectrum, float *fiedler, const inchi_t *g)
+bipartite_vector (spectral_t *sp, int k, double *x)
 {
-  double *a, *d;
-  const int *G = inchi_matrix_A (g);
-  size_t size = inchi_matrix_size (g);
-  int i, j, v, err = 0, nv = g->nv;
+  const int *ap, *aj;
+  solver_ws_t *ws = sp->ws;
+  int i, q, c, m, err = 0, n = sp->size, p = sp->bipartite;
+  double sign = 1., h;
 
-  a = malloc (sizeof (double)*nv*nv);
-  d = malloc (nv *sizeof (double));
+  ap = inchi_adjacency (sp->inchi, &aj);
 
-  /* normalized laplacian */
-  for (i = 0; i < nv; ++i)
+  if (k < p)
+    m = p-1-k;
+  else if (k >= n-p)
     {
-      d[i] = 0.;
-      for (j = 0; j < nv; ++j)
-        if (i != j)
-          {
-            v = __get_edge (i+1, j+1);
-            d[i] += v;
-          }
-
-      a[i*nv+i] = 1;
+      m = k-(n-p);
+      sign = -1.;
+    }
+  else
+    m = -1;
 
-      /* upper triangle */
-      for (j = 0; j < i; ++j)
+  if (sp->vectors != n && m >= 0 && sp->sigma[m] >= BIPARTITE_EPS)
+    {
+      if (sp->vectors != p)
         {
-          a[j*nv+i] = __get_edge (j+1, i+1) ? -1./sqrt (d[i]*d[j]) : 0;
-          a[i*nv+j] = 0.;
+          (void) bipartite_matrix (sp, ws->a, sp->inchi);
+          err = (*sp->used->solve) (ws, p, 1);
+          if (err < 0)
+            return err;
+          bipartite_unfold (sp, n);
+          sp->vectors = p;
         }
+
+      for (i = 0, c = 0; i < n; ++i)
+        if (sp->side[i] == 0)
+          x[i] = ws->z[(c++)*p+m] / M_SQRT2;
+      for (i = 0; i < n; ++i)
+        if (sp->side[i] != 0)
+          {
+            h = 0.;
+            for (q = ap[i]; q < ap[i+1]; ++q)
+              h += x[aj[q]] / sqrt ((ap[i+1]-ap[i])
+                                    *(ap[aj[q]+1]-ap[aj[q]]));
+            x[i] = sign * h / sp->sigma[m];
+          }
+      return 0;
     }
 
-#ifdef SPECTRAL_DEBUG
-  printf ("G = \n");
-  for (i = 0; i < nv; ++i)
+  if (sp->vectors != n)
     {
-      for (j = 0; j < nv; ++j)
-        printf (" %-4.5f", a[i*nv+j]);
-      printf ("\n");
+      normalized_matrix (ws->a, ap, aj, 0, n);
+      err = (*sp->used->solve) (ws, n, 1);
+      sp->vectors = err == 0 ? n : 0;
     }
-#endif
+  for (i = 0; err == 0 && i < n; ++i)
+    x[i] = ws->z[i*n+k];
+  return err;
+}
+
+/*
+ * coarsest equitable partition by color refinement of the graph with
+ * adjacency lists j[p[i]..p[i+1]-1]: all vertices start out alike and are
+ * told apart by their color and the multiset of their neighbors' colors
+ * until that splits no further. every vertex of a cell then has the same
+ * number of neighbors in any given cell. the cell of each vertex
+ * (numbered in order of first appearance) goes into color; returns the
+ * number of cells or 0 as soon as there are more than maxr of them.
+ */
+static int
+equitable_partition (const int *p, const int *j, int nv, int maxr,
+                     int *color, int *scratch)
+{
+  int i, k, q, c, r = 1, nr, *rep = scratch, *next = scratch + nv,
+    *nb = scratch + 3*nv;
+  unsigned *hash = (unsigned *)(scratch + 2*nv); /* wraps around */
+
+  for (i = 0; i < nv; ++i)
+    color[i] = 0;
 
-  err = LAPACKE_dsyevd (LAPACK_ROW_MAJOR, 'V', 'U', nv, a, nv, d);
-  if (err == 0)
+  for (;;)
     {
-      int k = 0;
-      while (k < nv && d[++k] < EPS)
-        ;
-#ifdef SPECTRAL_DEBUG  
-      printf ("Eigenvector of the second smallest eigenvalue (%d: %.5f):\n",
-              k, d[k]);
-#endif
-      
+      /* sorted colors of the neighbors of each vertex */
       for (i = 0; i < nv; ++i)
         {
-          spectrum[i] = d[i];
-          fiedler[i] = a[i*nv+k];
-#ifdef SPECTRAL_DEBUG   
-          printf ("% 3d: % 11.10f\n", i, fiedler[i]);
-#endif
+          for (q = p[i]; q < p[i+1]; ++q)
+            {
+              c = color[j[q]];
+              for (k = q; k > p[i] && nb[k-1] > c; --k)
+                nb[k] = nb[k-1];
+              nb[k] = c;
+            }
+          for (q = p[i], hash[i] = color[i]; q < p[i+1]; ++q)
+            hash[i] = hash[i]*31u + (unsigned) nb[q];
         }
-    }
 
-  free (d);
-  free (a);
+      for (i = 0, nr = 0; i < nv; ++i)
+        {
+          for (c = 0; c < nr; ++c)
+            {
+              k = rep[c];
+              if (hash[k] == hash[i]
+                  && color[k] == color[i] && p[k+1]-p[k] == p[i+1]-p[i]
+                  && memcmp (nb+p[k], nb+p[i],
+                             (p[i+1]-p[i])*sizeof (int)) == 0)
+                break;
+            }
+          if (c == nr)
+            rep[nr++] = i;
+          next[i] = c;
+        }
 
-  return err;
-}
+      /* refinement never merges cells */
+      if (nr == r)
+        break;
+      else if (nr > maxr)
+        return 0;
+      r = nr;
+      (void) memcpy (color, next, nv*sizeof (int));
+    }
 
-#else
+  return r;
+}
 
+/*
+ * the cell-constant vectors are invariant under the normalized laplacian
+ * L of a graph with an equitable partition, and so is their orthogonal
+ * complement. in the basis 1_i/sqrt(n_i) of the former, L is the r x r
+ *
+ *   Q_ij = [i == j] - b_ij sqrt(n_i/n_j)/sqrt(d_i d_j)
+ *
+ * with b_ij the neighbors a vertex of cell i has in cell j. the latter is
+ * spanned by the helmert basis of each cell, h_k = (1, .., 1, -k, 0, ..)
+ * / sqrt(k(k+1)) over its members, in which L is H'LH. both blocks are
+ * solved and their eigenvalues merged into ws->w. returns the number of
+ * cells or 0 (with nothing solved) if the split doesn't pay.
+ */
 static int
-graph_spectrum (float *spectrum, float *fiedler, const inchi_t *g)
+equitable_spectrum (spectral_t *sp, const int *p, const int *j, int nv)
 {
-  double **evec, **a, *d;
-  int i, err = 0, nv = inchi_node_count (g);
-  const int *G = inchi_matrix_A (g);
-  size_t size = inchi_matrix_size (g);
-  
-  a = malloc (sizeof (double *)*nv);
-  d = malloc (sizeof (double)*nv);
-  evec = malloc (sizeof (double *)*nv);
-  for (i = 0; i < nv; ++i)
+  solver_ws_t *ws = sp->ws;
+  int i, k, q, c, r, nc, col, *color, *start, *member;
+  double h, x, *T, *P, *wq;
+
+  color = malloc ((6*nv + 1 + p[nv])*sizeof (int));
+  start = color + nv;
+  member = start + nv + 1;
+
+  r = equitable_partition (p, j, nv, (int)(SPECTRAL_EQUITABLE * nv), color,
+                           member + nv);
+  nc = nv - r;
+  if (r == 0 || nc == 0 || nc > SPECTRAL_EQUITABLE * nv)
     {
-      a[i] = malloc (nv*sizeof (double));
-      evec[i] = malloc (nv*sizeof (double));
+      free (color);
+      return 0;
     }
 
-  spectral_normalized_graph (a, G, nv, size);
-
-#ifdef SPECTRAL_DEBUG
-  printf ("G = \n");
-  for (i = 0; i < nv; ++i)
+  if (sp->esize < nv)
     {
-      int j;
-      for (j = 0; j < nv; ++j)
-        printf ("%s%.1f", j==0?"":"&", a[i][j]);
-      printf (" \\\\\n");
+      sp->eq = realloc (sp->eq, nv*nv*sizeof (double));
+      sp->esize = nv;
     }
 
-  printf ("[");
+  /* members of each cell in vertex order */
+  for (c = 0; c <= r; ++c)
+    start[c] = 0;
+  for (i = 0; i < nv; ++i)
+    ++start[color[i]+1];
+  for (c = 0; c < r; ++c)
+    start[c+1] += start[c];
   for (i = 0; i < nv; ++i)
+    member[start[color[i]]++] = i;
+  for (c = r; c > 0; --c)
+    start[c] = start[c-1];
+  start[0] = 0;
+
+#define __degree(u) (p[(u)+1] - p[u])
+  /* T = L H one column (n-vector) at a time, from a running prefix sum
+     of the columns of L over the members of the cell */
+  T = sp->eq;
+  P = ws->x;
+  for (c = 0, col = 0; c < r; ++c)
     {
-      int j;
-      for (j = 0; j < nv; ++j)
-        printf (" %.5f", a[i][j]);
-      printf (";\n");
+      for (i = 0; i < nv; ++i)
+        P[i] = 0.;
+      for (k = 1; k < start[c+1] - start[c]; ++k, ++col)
+        {
+          int m = member[start[c]+k-1], u = member[start[c]+k];
+          double *t = T + (size_t)col*nv;
+          P[m] += 1.;
+          for (q = p[m]; q < p[m+1]; ++q)
+            P[j[q]] -= 1./sqrt ((double)__degree (m)*__degree (j[q]));
+          h = 1./sqrt (k*(k+1.));
+          for (i = 0; i < nv; ++i)
+            t[i] = h*P[i];
+          t[u] -= h*k;
+          for (q = p[u]; q < p[u+1]; ++q)
+            t[j[q]] += h*k/sqrt ((double)__degree (u)*__degree (j[q]));
+        }
     }
-  printf ("]\n");
-#endif
-
-  err = jacobi (a, nv, d, evec);
-
-  { int k = 0;
-    while (k < nv && d[++k] < EPS)
-      ;
-    
-#ifdef SPECTRAL_DEBUG    
-    printf ("Eigenvector of the second smallest eigenvalue (%d: %.5f):\n",
-            k, d[k]);
-#endif
-    
-    for (i = 0; i < nv; ++i)
-      {
-        spectrum[i] = d[i];
-        fiedler[i] = evec[i][k];
-#ifdef SPECTRAL_DEBUG
-        printf ("% 3d: % 11.10f\n", i, fiedler[i]);
-#endif
-        free (a[i]);    
-      }
-    
-    for (i = 0; i < nv; ++i)
-      free (evec[i]);
-  }
-  
-  free (d);
-  free (a);
-  free (evec);
 
-  return err;
-}
-#endif /* !HAVE_GSL */
-
-
-static int
-spectral_inchi (spectral_t *sp, const char *inchi)
-{
-  int nv;
+  /* H'LH = H'T, the same way along the columns of T */
+  for (col = 0; col < nc; ++col)
+    {
+      const double *t = T + (size_t)col*nv;
+      for (c = 0, q = 0; c < r; ++c)
+        for (k = 1, x = t[member[start[c]]];
+             k < start[c+1] - start[c]; ++k, ++q)
+          {
+            ws->a[q*nc+col] = (x - k*t[member[start[c]+k]])
+              / sqrt (k*(k+1.));
+            x += t[member[start[c]+k]];
+          }
+    }
+  for (i = 0; i < nc; ++i)
+    for (k = 0; k < i; ++k)
+      ws->a[i*nc+k] = ws->a[k*nc+i] = (ws->a[i*nc+k] + ws->a[k*nc+i])/2.;
 
-  nv = inchi_parse (sp->inchi, inchi);
-  if (nv < 0)
-    (void) strcpy (sp->errmsg, inchi_error (sp->inchi));
-  else if (nv > SPECTRAL_MAXG)
+  if ((*sp->used->solve) (ws, nc, 0) < 0)
     {
-      sprintf (sp->errmsg, "Graph is too large (%d > %d) for eigensolver",
-               nv, SPECTRAL_MAXG);
-      nv = -1;
+      free (color);
+      return -1;
     }
-  else
+  wq = sp->eq + nc;
+  (void) memcpy (sp->eq, ws->w, nc*sizeof (double));
+
+  /* quotient from a representative of each cell */
+  for (c = 0; c < r; ++c)
     {
-      if (sp->bsize < nv)
-        {
-          sp->spectrum = realloc (sp->spectrum, nv*sizeof (float));
-          sp->fiedler = realloc (sp->fiedler, nv*sizeof (float));
-          sp->bsize = nv;
-        }
-      /* make sure the elements are 0s */
-      (void) memset (sp->spectrum, 0, sp->bsize*sizeof (float));
-      (void) memset (sp->fiedler, 0, sp->bsize*sizeof (float));
-      sp->size = nv;
-      
-#ifdef SPECTRAL_DEBUG
-      printf ("## %d /c = %s\n", nv, inchi_layer_c (sp->inchi));
-#endif
-      
-      if (graph_spectrum (sp->spectrum, sp->fiedler, sp->inchi) < 0)
+      int u = member[start[c]];
+      for (k = 0; k < r; ++k)
+        ws->a[c*r+k] = c == k ? 1. : 0.;
+      for (q = p[u]; q < p[u+1]; ++q)
         {
-          sprintf (sp->errmsg, "Eigensolver didn't converge within "
-                   "specified number of iterations");
-          nv = -1;
+          k = color[j[q]];
+          ws->a[c*r+k] -= sqrt ((double)(start[c+1]-start[c])
+                                /(start[k+1]-start[k]))
+            / sqrt ((double)__degree (u)*__degree (j[q]));
         }
     }
-  
-  return nv;
-}
+#undef __degree
+  for (c = 0; c < r; ++c)
+    for (k = 0; k < c; ++k)
+      ws->a[c*r+k] = ws->a[k*r+c] = (ws->a[c*r+k] + ws->a[k*r+c])/2.;
 
-#undef __set_edge
-#undef __get_edge
+  free (color);
+  if ((*sp->used->solve) (ws, r, 0) < 0)
+    return -1;
+  (void) memcpy (wq, ws->w, r*sizeof (double));
 
+  for (i = 0, k = 0, q = 0; i < nv; ++i)
+    ws->w[i] = q == r || (k < nc && sp->eq[k] < wq[q]) ? sp->eq[k++]
+      : wq[q++];
 
-spectral_t *
-spectral_create ()
-{
-  spectral_t *sp = malloc (sizeof (struct __spectral_s));
-  if (sp != 0)
-    {
-      sp->bsize = 0;
-      sp->spectrum = 0;
-      sp->fiedler = 0;
-      sp->inchi = inchi_create ();
-      (void) memset (sp->hashkey, 0, sizeof (sp->hashkey));
-      (void) memset (sp->errmsg, 0, sizeof (sp->errmsg));
-      sp->sha1 = sha1_create ();
-    }
-  return sp;
+  return r;
 }
 
-void
-spectral_free (spectral_t *sp)
+/*
+ * eigenvalues within SOLVER_ZERO_EPS of 0 are rounding noise, whose sign
+ * depends on the solver; they're stored as 0
+ */
+static float
+spectrum_value (double x)
 {
+  return fabs (x) < SOLVER_ZERO_EPS ? 0.f : (float) x;
+}
+
+/*
+ * eigenvalues left in ws->w into sp->spectrum
+ */
+static void
+graph_eigenvalues (spectral_t *sp, int nv)
+{
+  const double *w = sp->ws->w;
+  int i, k;
+
+  for (i = 0; i < nv; ++i)
+    sp->spectrum[i] = spectrum_value (w[i]);
+
+  /* smallest, non-zero eigenvalue */
+  for (k = 1; k < nv-1 && w[k] < SOLVER_ZERO_EPS; ++k)
+    ;
+  sp->fiedler_k = k < nv ? k : 0;
+}
+
+/*
+ * eigenvalues only; eigenvectors are computed on demand by
+ * spectral_vector from whatever the solver left in the workspace.
+ * unless exact is zero, a forced solver that only gets the eigenvalues
+ * right to digest precision is passed over for the policy's choice
+ */
+static int
+graph_spectrum (spectral_t *sp, const inchi_t *g, int exact)
+{
+  int nv = inchi_node_count (g);
+  const int *j, *p = inchi_adjacency (g, &j);
+  solver_ws_t *ws = sp->ws;
+
+  solver_ws_reserve (ws, nv);
+  sp->used = sp->solver != 0 && !(exact && sp->solver->approx)
+    ? sp->solver : solver_select (&sp->policy, nv);
+  sp->vector_k = -1;
+  sp->vectors = 0;
+
+  /*
+   * a solver that's only accurate to digest precision would settle for
+   * that on B B' rather than on the graph's spectrum
+   */
+  sp->bipartite = sp->used->approx ? 0
+    : bipartite_matrix (sp, ws->a, g);
+  if (sp->bipartite > 0)
+    {
+      if ((*sp->used->solve) (ws, sp->bipartite, 0) < 0)
+        return -1;
+      bipartite_unfold (sp, nv);
+      goto spectrum;
+    }
+
+  sp->equitable = sp->used->approx || SPECTRAL_EQUITABLE <= 0. ? 0
+    : equitable_spectrum (sp, p, j, nv);
+  if (sp->equitable < 0)
+    return -1;
+  else if (sp->equitable > 0)
+    goto spectrum;
+
+  normalized_matrix (ws->a, p, j, 0, nv);
+
+#ifdef SPECTRAL_DEBUG
+  printf ("G = [");
+  { int i, j;
+  for (i = 0; i < nv; ++i)
+    {
+      for (j = 0; j < nv; ++j)
+        printf (" %-4.5f", ws->a[i*nv+j]);
+      printf (";\n");
+    }
+  }
+  printf ("];\n");
+#endif
+
+  if ((*sp->used->solve) (ws, nv, 0) < 0)
+    return -1;
+
+ spectrum:
+  graph_eigenvalues (sp, nv);
+  return 0;
+}
+
+/*
+ * sparse weighted normalized laplacian of the graph into a dense row
+ * major buffer
+ */
+static void
+weighted_matrix (double *a, const int *p, const int *j, const double *w,
+                 int nv)
+{
+  int i, q;
+
+  (void) memset (a, 0, (size_t)nv*nv*sizeof (double));
+  for (i = 0; i < nv; ++i)
+    for (q = p[i]; q < p[i+1]; ++q)
+      a[i*nv+j[q]] = w[q];
+}
+
+/*
+ * bipartite_matrix for the weighted laplacian: B B' into a and the side
+ * of each vertex into sp->side, straight from the sparse form
+ */
+static int
+weighted_bipartite (spectral_t *sp, double *a, const int *p, const int *j,
+                    const double *w, int nv)
+{
+  int i, k, q, u, b, *index, *queue;
+  double *bv;
+
+  b = bipartite_sides (sp, sp->inchi);
+  if (b <= 0)
+    return 0;
+
+  index = malloc (2*nv*sizeof (int));
+  queue = index + nv;
+  for (i = 0, q = 0, k = 0; i < nv; ++i)
+    index[i] = sp->side[i] == 0 ? q++ : k++;
+
+  for (i = 0; i < b*b; ++i)
+    a[i] = 0.;
+
+  bv = malloc (nv*sizeof (double));
+  for (u = 0; u < nv; ++u)
+    if (sp->side[u] != 0)
+      {
+        for (q = p[u], k = 0; q < p[u+1]; ++q)
+          if (j[q] != u)
+            {
+              queue[k] = index[j[q]];
+              bv[k++] = -w[q];
+            }
+        for (i = 0; i < k; ++i)
+          for (q = 0; q < k; ++q)
+            a[queue[i]*b+queue[q]] += bv[i]*bv[q];
+      }
+  free (bv);
+  free (index);
+  return b;
+}
+
+/*
+ * graph_spectrum for the weighted laplacian; bipartite graphs take the
+ * same shortcut, but there's no equitable split since bond weights
+ * rarely leave any symmetry to split along
+ */
+static int
+weighted_spectrum (spectral_t *sp, int nv, int exact)
+{
+  const int *p, *j;
+  const double *w = inchi_matrix_W (sp->inchi, &p, &j);
+  solver_ws_t *ws = sp->ws;
+
+  solver_ws_reserve (ws, nv);
+  sp->used = sp->solver != 0 && !(exact && sp->solver->approx)
+    ? sp->solver : solver_select (&sp->policy, nv);
+  sp->vector_k = -1;
+  sp->vectors = 0;
+
+  sp->bipartite = sp->used->approx ? 0
+    : weighted_bipartite (sp, ws->a, p, j, w, nv);
+  if (sp->bipartite > 0)
+    {
+      if ((*sp->used->solve) (ws, sp->bipartite, 0) < 0)
+        return -1;
+      bipartite_unfold (sp, nv);
+    }
+  else
+    {
+      weighted_matrix (ws->a, p, j, w, nv);
+      if ((*sp->used->solve) (ws, nv, 0) < 0)
+        return -1;
+    }
+
+  graph_eigenvalues (sp, nv);
+  return 0;
+}
+
+/*
+ * sparse normalized laplacian of g and the null vector of each of its
+ * connected components, i.e., D^{1/2}1 restricted to the component and
+ * normalized; isolated vertices are left out since their eigenvalue is
+ * 1. returns the number of null vectors.
+ */
+static int
+graph_sparse (spectral_t *sp, const inchi_t *g)
+{
+  int i, k, q, c, head, tail, nv = inchi_node_count (g);
+  const int *aj, *ap = inchi_adjacency (g, &aj);
+  int nnz = nv + ap[nv], *queue;
+  double sum;
+
+  if (sp->ssize < nv)
+    {
+      sp->sp_p = realloc (sp->sp_p, (nv+1)*sizeof (int));
+      sp->comp = realloc (sp->comp, nv*sizeof (int));
+      sp->null = realloc (sp->null, nv*sizeof (double));
+      sp->ssize = nv;
+    }
+  queue = malloc (nv*sizeof (int));
+
+#define __degree(u) (ap[(u)+1] - ap[u])
+  if (sp->nsize < nnz)
+    {
+      sp->sp_j = realloc (sp->sp_j, nnz*sizeof (int));
+      sp->sp_v = realloc (sp->sp_v, nnz*sizeof (double));
+      sp->nsize = nnz;
+    }
+
+  /* the diagonal in its place among the (sorted) neighbors */
+  for (i = 0, k = 0; i < nv; ++i)
+    {
+      sp->sp_p[i] = k;
+      for (q = ap[i]; q < ap[i+1] && aj[q] < i; ++q)
+        {
+          sp->sp_j[k] = aj[q];
+          sp->sp_v[k++] = -1./sqrt (__degree (i)*__degree (aj[q]));
+        }
+      sp->sp_j[k] = i;
+      sp->sp_v[k++] = 1.;
+      for (; q < ap[i+1]; ++q)
+        {
+          sp->sp_j[k] = aj[q];
+          sp->sp_v[k++] = -1./sqrt (__degree (i)*__degree (aj[q]));
+        }
+      sp->comp[i] = -1;
+    }
+  sp->sp_p[nv] = k;
+
+  for (i = 0, c = 0; i < nv; ++i)
+    if (sp->comp[i] < 0 && __degree (i) > 0)
+      {
+        sp->comp[i] = c;
+        queue[0] = i;
+        sum = 0.;
+        for (head = 0, tail = 1; head < tail; ++head)
+          {
+            int u = queue[head];
+            sum += __degree (u);
+            for (k = sp->sp_p[u]; k < sp->sp_p[u+1]; ++k)
+              if (sp->comp[sp->sp_j[k]] < 0 && sp->sp_j[k] != u)
+                {
+                  sp->comp[sp->sp_j[k]] = c;
+                  queue[tail++] = sp->sp_j[k];
+                }
+          }
+        for (head = 0; head < tail; ++head)
+          sp->null[queue[head]] = sqrt (__degree (queue[head]) / sum);
+        ++c;
+      }
+#undef __degree
+
+  free (queue);
+  return c;
+}
+
+/*
+ * parse inchi into sp->inchi; only the weighted laplacian needs the
+ * atoms and bond orders, the rest of the keys and spectra go by the
+ * connection layer alone. the spectrum of the last graph goes with it,
+ * even if the parse fails, so spectral_spectrum and spectral_vector
+ * have nothing to go on until the caller solves the new one
+ */
+static int
+spectral_parse (spectral_t *sp, const char *inchi, int weighted)
+{
+  int nv;
+
+  sp->size = 0;
+  sp->used = 0;
+  nv = weighted ? inchi_parse (sp->inchi, inchi)
+    : inchi_parse_c (sp->inchi, inchi);
+  if (nv < 0)
+    (void) strcpy (sp->errmsg, inchi_error (sp->inchi));
+  else if (nv > SPECTRAL_MAXG)
+    {
+      sprintf (sp->errmsg, "Graph is too large (%d > %d) for eigensolver",
+               nv, SPECTRAL_MAXG);
+      nv = -1;
+    }
+  return nv;
+}
+
+/*
+ * spectrum of the graph last parsed into sp->inchi; nv is what
+ * inchi_parse returned (0 if there's no /c layer, in which case the
+ * graph isn't touched); exact as for graph_spectrum; weighted for the
+ * weighted laplacian instead of the plain one
+ */
+static int
+spectral_graph (spectral_t *sp, int nv, int exact, int weighted)
+{
+  if (sp->bsize < nv)
+    {
+      sp->spectrum = realloc (sp->spectrum, nv*sizeof (float));
+      sp->vector = realloc (sp->vector, nv*sizeof (float));
+      sp->side = realloc (sp->side, nv*sizeof (int));
+      sp->sigma = realloc (sp->sigma, nv*sizeof (double));
+      sp->bsize = nv;
+    }
+  /* make sure the elements are 0s */
+  (void) memset (sp->spectrum, 0, sp->bsize*sizeof (float));
+  (void) memset (sp->vector, 0, sp->bsize*sizeof (float));
+  sp->size = nv;
+
+#ifdef SPECTRAL_DEBUG
+  printf ("## %d /c = %s\n", nv, inchi_layer_c (sp->inchi));
+#endif
+
+  sp->used = 0;
+  sp->bipartite = 0;
+  sp->equitable = 0;
+  sp->weighted = weighted;
+  if (nv > 0 && (weighted ? weighted_spectrum (sp, nv, exact)
+                 : graph_spectrum (sp, sp->inchi, exact)) < 0)
+    {
+      sprintf (sp->errmsg, "Eigensolver didn't converge within "
+               "specified number of iterations");
+      return -1;
+    }
+
+  return nv;
+}
+
+static int
+spectral_inchi (spectral_t *sp, const char *inchi)
+{
+  int nv = spectral_parse (sp, inchi, 0);
+  return nv < 0 ? nv : spectral_graph (sp, nv, 0, 0);
+}
+
+/*
+ * the exact characteristic polynomial of the graph last parsed into
+ * sp->inchi into sp->sha1 (see spectral_digest_exact)
+ */
+static int
+digest_cpoly (spectral_t *sp, int nv)
+{
+  const int *j, *p = inchi_adjacency (sp->inchi, &j);
+  const unsigned char *bytes;
+  size_t len;
+  int err;
+
+  if (nv == 0)
+    return 0;
+
+  if (sp->cp == 0)
+    sp->cp = cpoly_create ();
+  err = cpoly_graph (sp->cp, nv, p, j);
+  if (err < 0)
+    {
+      (void) strcpy (sp->errmsg, "Can't allocate memory for the "
+                     "characteristic polynomial");
+      return -1;
+    }
+
+  bytes = cpoly_bytes (sp->cp, &len);
+  sha1_update (sp->sha1, bytes, len);
+  return 0;
+}
+
+/*
+ * matrix of the given type (see spectral_spectra) of the graph with
+ * adjacency lists j[p[i]..p[i+1]-1] into a; same values as the
+ * spectral_*_graph functions
+ */
+static void
+spectra_matrix (double *a, int type, const int *p, const int *j, int nv)
+{
+  int i, q, d;
+
+  (void) memset (a, 0, (size_t)nv*nv*sizeof (double));
+  for (i = 0; i < nv; ++i)
+    {
+      d = p[i+1] - p[i];
+      switch (type)
+        {
+        case SPECTRAL_ADJACENCY:
+          for (q = p[i]; q < p[i+1]; ++q)
+            a[i*nv+j[q]] = 1.;
+          break;
+
+        case SPECTRAL_LAPLACIAN:
+          a[i*nv+i] = d;
+          for (q = p[i]; q < p[i+1]; ++q)
+            a[i*nv+j[q]] = -1.;
+          break;
+
+        case SPECTRAL_SIGNLESS:
+          a[i*nv+i] = d;
+          for (q = p[i]; q < p[i+1]; ++q)
+            a[i*nv+j[q]] = 1.;
+          break;
+
+        case SPECTRAL_NORMALIZED:
+          a[i*nv+i] = 1.;
+          for (q = p[i]; q < p[i+1]; ++q)
+            a[i*nv+j[q]] = -1./sqrt (d*(p[j[q]+1] - p[j[q]]));
+          break;
+        }
+    }
+}
+
+/*
+ * spectra of the matrices in mask of the graph last parsed into
+ * sp->inchi, each assembled straight into its own workspace from one set
+ * of adjacency lists (and degrees)
+ */
+static int
+graph_spectra (spectral_t *sp, int nv, int mask)
+{
+  const int *j, *p = inchi_adjacency (sp->inchi, &j);
+  const solver_t *s;
+  int t, i, err = 0;
+
+  if (sp->msize < nv)
+    {
+      for (t = 0; t < SPECTRAL_TYPES; ++t)
+        sp->mspectrum[t] = realloc (sp->mspectrum[t], nv*sizeof (float));
+      sp->msize = nv;
+    }
+  if (nv == 0)
+    return 0;
+
+  /* the digest precision of an approximate solver is no use here */
+  s = sp->solver != 0 && !sp->solver->approx
+    ? sp->solver : solver_select (&sp->policy, nv);
+
+#ifdef _OPENMP
+# pragma omp parallel for private(i) reduction(|:err) schedule(dynamic) \
+  if (nv >= SPECTRAL_PARALLELG)
+#endif
+  for (t = 0; t < SPECTRAL_TYPES; ++t)
+    if (mask & (1 << t))
+      {
+        if (sp->mws[t] == 0)
+          sp->mws[t] = solver_ws_create ();
+        solver_ws_reserve (sp->mws[t], nv);
+        spectra_matrix (sp->mws[t]->a, 1 << t, p, j, nv);
+        if ((*s->solve) (sp->mws[t], nv, 0) < 0)
+          err = 1;
+        else
+          for (i = 0; i < nv; ++i)
+            sp->mspectrum[t][i] = spectrum_value (sp->mws[t]->w[i]);
+      }
+
+  if (err)
+    {
+      sprintf (sp->errmsg, "Eigensolver didn't converge within "
+               "specified number of iterations");
+      return -1;
+    }
+  return nv;
+}
+
+#undef __set_edge
+#undef __get_edge
+
+
+/*
+ * $SPECTRAL_PROFILE if set, otherwise SPECTRAL_PROFILE in $HOME
+ */
+static const char *
+profile_path (char *path, size_t size)
+{
+  const char *file = getenv ("SPECTRAL_PROFILE"), *home;
+  if (file != 0)
+    return file;
+
+  home = getenv ("HOME");
+  if (home == 0)
+    return 0;
+
+  (void) snprintf (path, size, "%s/%s", home, SPECTRAL_PROFILE);
+  return path;
+}
+
+spectral_t *
+spectral_create ()
+{
+  spectral_t *sp = malloc (sizeof (struct __spectral_s));
+  int i;
+  if (sp != 0)
+    {
+      sp->bsize = 0;
+      sp->spectrum = 0;
+      sp->vector = 0;
+      sp->vector_k = -1;
+      sp->fiedler_k = 0;
+      sp->vectors = 0;
+      sp->weighted = 0;
+      sp->bipartite = 0;
+      sp->side = 0;
+      sp->sigma = 0;
+      sp->equitable = 0;
+      sp->esize = 0;
+      sp->eq = 0;
+      sp->inchi = inchi_create ();
+      sp->ws = solver_ws_create ();
+      solver_policy_default (&sp->policy, SPECTRAL_MAXG);
+      { char path[BUFSIZ];
+        const char *file = profile_path (path, sizeof (path));
+        if (file != 0)
+          (void) solver_policy_load (&sp->policy, file, SPECTRAL_MAXG);
+      }
+      sp->solver = 0;
+      sp->used = 0;
+      sp->lz = 0;
+      sp->cp = 0;
+      sp->msize = 0;
+      for (i = 0; i < SPECTRAL_TYPES; ++i)
+        {
+          sp->mws[i] = 0;
+          sp->mspectrum[i] = 0;
+        }
+      sp->ssize = sp->nsize = 0;
+      sp->sp_p = sp->sp_j = sp->comp = 0;
+      sp->sp_v = sp->null = 0;
+      sp->csize = sp->cvsize = 0;
+      sp->component = 0;
+      sp->ckey = 0;
+      sp->cws = 0;
+      sp->cspectrum = 0;
+      { const char *name = getenv ("SPECTRAL_SOLVER");
+        if (name != 0 && spectral_set_solver (sp, name) < 0)
+          fprintf (stderr, "** warning: unknown solver SPECTRAL_SOLVER=%s; "
+                   "using default policy **\n", name);
+      }
+      (void) memset (sp->hashkey, 0, sizeof (sp->hashkey));
+      (void) memset (sp->errmsg, 0, sizeof (sp->errmsg));
+      sp->sha1 = sha1_create ();
+    }
+  return sp;
+}
+
+void
+spectral_free (spectral_t *sp)
+{
+  int i;
   if (sp != 0)
     {
       if (sp->spectrum != 0)
         free (sp->spectrum);
-      if (sp->fiedler != 0)
-        free (sp->fiedler);
+      if (sp->vector != 0)
+        free (sp->vector);
+      if (sp->side != 0)
+        free (sp->side);
+      if (sp->sigma != 0)
+        free (sp->sigma);
+      if (sp->eq != 0)
+        free (sp->eq);
       sha1_free (sp->sha1);
       inchi_free (sp->inchi);
+      solver_ws_free (sp->ws);
+      if (sp->lz != 0)
+        lanczos_free (sp->lz);
+      if (sp->cp != 0)
+        cpoly_free (sp->cp);
+      for (i = 0; i < SPECTRAL_TYPES; ++i)
+        {
+          if (sp->mws[i] != 0)
+            solver_ws_free (sp->mws[i]);
+          if (sp->mspectrum[i] != 0)
+            free (sp->mspectrum[i]);
+        }
+      if (sp->sp_p != 0)
+        free (sp->sp_p);
+      if (sp->sp_j != 0)
+        free (sp->sp_j);
+      if (sp->sp_v != 0)
+        free (sp->sp_v);
+      if (sp->comp != 0)
+        free (sp->comp);
+      if (sp->null != 0)
+        free (sp->null);
+      for (i = 0; i < sp->csize; ++i)
+        if (sp->cws[i] != 0)
+          solver_ws_free (sp->cws[i]);
+      if (sp->csize > 0)
+        {
+          free (sp->component);
+          free (sp->ckey);
+          free (sp->cws);
+        }
+      if (sp->cspectrum != 0)
+        free (sp->cspectrum);
       free (sp);
     }
 }
 
+/*
+ * a solver that's only accurate to digest precision (see solver_t) is
+ * kept to the digest: the spectrum it left behind is replaced by that of
+ * the policy's solver before anyone else gets to see it
+ */
+static int
+spectral_exact (spectral_t *sp)
+{
+  if (sp->used == 0 || !sp->used->approx)
+    return 0;
+  return spectral_graph (sp, sp->size, 1, sp->weighted) < 0 ? -1 : 0;
+}
+
 const float *
 spectral_spectrum (const spectral_t *sp)
 {
-  return sp->spectrum;
+  spectral_t *self = (spectral_t *)sp; /* caching only */
+  return spectral_exact (self) < 0 ? 0 : sp->spectrum;
 }
 
+/*
+ * the k-th eigenvector (in ascending order of eigenvalue) of the last
+ * graph; computed on first request with the solver's single vector hook
+ * if it has one, otherwise by solving for all eigenvectors once. only
+ * the last eigenvector asked for is kept. its sign is normalized, so it
+ * doesn't depend on the solver.
+ */
+const float *
+spectral_vector (const spectral_t *sp, int k)
+{
+  spectral_t *self = (spectral_t *)sp; /* caching only */
+  solver_ws_t *ws = sp->ws;
+  int i, n = sp->size, err = 0;
+  double sign;
+
+  if (k < 0 || k >= n || sp->used == 0 || spectral_exact (self) < 0)
+    return 0;
+
+  if (k == sp->vector_k)
+    return sp->vector;
+
+  if (sp->bipartite > 0 && !sp->weighted)
+    err = bipartite_vector (self, k, ws->x);
+  else if (sp->vectors != n && sp->used->vector != 0 && !sp->equitable
+           && !sp->bipartite)
+    err = (*sp->used->vector) (ws, n, k, ws->x);
+  else
+    {
+      if (sp->vectors != n)
+        {
+          if (sp->weighted)
+            {
+              const int *p, *j;
+              const double *w = inchi_matrix_W (sp->inchi, &p, &j);
+              weighted_matrix (ws->a, p, j, w, n);
+            }
+          else
+            {
+              const int *p, *j;
+              p = inchi_adjacency (sp->inchi, &j);
+              normalized_matrix (ws->a, p, j, 0, n);
+            }
+          err = (*sp->used->solve) (ws, n, 1);
+          self->vectors = err == 0 ? n : 0;
+        }
+      for (i = 0; err == 0 && i < n; ++i)
+        ws->x[i] = ws->z[i*n+k];
+    }
+
+  if (err < 0)
+    {
+      sprintf (self->errmsg, "Eigensolver failed to compute eigenvector %d",
+               k);
+      return 0;
+    }
+
+  /* the sign is the solver's choice; make the first component that
+     isn't noise positive */
+  for (i = 0; i < n && fabs (ws->x[i]) < SOLVER_ZERO_EPS; ++i)
+    ;
+  sign = i < n && ws->x[i] < 0. ? -1. : 1.;
+  for (i = 0; i < n; ++i)
+    self->vector[i] = fabs (ws->x[i]) < SOLVER_ZERO_EPS ? 0.f
+      : sign*ws->x[i];
+  self->vector_k = k;
+
+#ifdef SPECTRAL_DEBUG
+  printf ("Eigenvector %d (%.5f) from %s:\n", k, ws->w[k], sp->used->name);
+  for (i = 0; i < n; ++i)
+    printf ("% 3d: % 11.10f\n", i, sp->vector[i]);
+#endif
+
+  return sp->vector;
+}
+
+/*
+ * eigenvector of the smallest, non-zero eigenvalue
+ */
 const float *
 spectral_fiedler (const spectral_t *sp)
 {
-  return sp->fiedler;
+  /* its index comes from the exact spectrum */
+  if (spectral_exact ((spectral_t *)sp) < 0)
+    return 0;
+  return spectral_vector (sp, sp->fiedler_k);
 }
 
 size_t
@@ -580,27 +1480,89 @@ spectral_error (const spectral_t *sp)
 const char *
 spectral_version ()
 {
-  return SPECTRAL_VERSION;
+  static char version[BUFSIZ] = {0};
+  if (version[0] == '\0')
+    {
+      const solver_t *s;
+      int i;
+      (void) strcpy (version, __SPECTRAL_VERSION " (");
+      for (i = 0; (s = solver_get (i)) != 0; ++i)
+        {
+          if (i > 0)
+            (void) strcat (version, ", ");
+          (void) strcat (version, s->version);
+        }
+      (void) strcat (version, ")");
+    }
+  return version;
+}
+
+int
+spectral_set_solver (spectral_t *sp, const char *name)
+{
+  const solver_t *s = 0;
+  if (name != 0 && *name != '\0' && strcmp (name, "auto") != 0)
+    {
+      s = solver_lookup (name);
+      if (s == 0)
+        {
+          sprintf (sp->errmsg, "Unknown solver '%s'", name);
+          return -1;
+        }
+    }
+  sp->solver = s;
+  return 0;
 }
 
 const char *
-spectral_digest (spectral_t *sp, const char *inchi)
+spectral_solver (const spectral_t *sp)
 {
-  char *start;
-  int size;
+  return sp->used != 0 ? sp->used->name : 0;
+}
 
-  size = spectral_inchi (sp, inchi);
-  if (size < 0)
-    return 0;
+int
+spectral_tune (const char *profile, int verbose)
+{
+  char path[BUFSIZ];
+  solver_policy_t policy;
+
+  if (profile == 0 && (profile = profile_path (path, sizeof (path))) == 0)
+    return -1;
+
+  if (solver_tune (&policy, SPECTRAL_MAXG, 0, verbose ? stderr : 0) < 0)
+    return -1;
+
+  if (verbose)
+    {
+      int i;
+      fprintf (stderr, "## writing profile %s:", profile);
+      for (i = 0; i < policy.count; ++i)
+        fprintf (stderr, " %s<=%d", policy.solver[i]->name, policy.size[i]);
+      fprintf (stderr, "\n");
+    }
+
+  return solver_policy_save (&policy, profile);
+}
+
+const char *
+spectral_solver_name (int i)
+{
+  const solver_t *s = solver_get (i);
+  return s != 0 ? s->name : 0;
+}
+
+/*
+ * hashkey (31 chars) from the topology block in sp->sha1 on, the
+ * connection layer inchi_c (if not null) and the whole inchi
+ */
+static const char *
+digest_key (spectral_t *sp, char *hashkey, const char *inchi_c,
+            const char *inchi)
+{
+  char *start;
 
-  sha1_reset (sp->sha1);
-  
-  /*
-   * first block is topology
-   */
-  digest_spectrum (sp, size);
   sha1_digest (sp->sha1, sp->digest);
-  start = sp->hashkey;
+  start = hashkey;
   b32_encode45 (&start, sp->digest, 20); /* 9 chars */
   
   /*
@@ -608,14 +1570,11 @@ spectral_digest (spectral_t *sp, const char *inchi)
    */
   sha1_reset (sp->sha1);
   sha1_update (sp->sha1, sp->digest, 20); /* chaining */
-  if (size > 0)
-    {
-      const char *inchi_c = inchi_layer_c (sp->inchi);
-      sha1_update (sp->sha1, (const unsigned char *)inchi_c, strlen (inchi_c));
-    }
+  if (inchi_c != 0)
+    sha1_update (sp->sha1, (const unsigned char *)inchi_c, strlen (inchi_c));
   
   sha1_digest (sp->sha1, sp->digest);
-  start = sp->hashkey + 9;
+  start = hashkey + 9;
   b32_encode50 (&start, sp->digest, 20); /* 10 chars */
   
   /*
@@ -625,35 +1584,391 @@ spectral_digest (spectral_t *sp, const char *inchi)
   sha1_update (sp->sha1, sp->digest, 20);
   sha1_update (sp->sha1, (const unsigned char *)inchi, strlen (inchi));
   sha1_digest (sp->sha1, sp->digest);
-  start = sp->hashkey + 19;
+  start = hashkey + 19;
   b32_encode55 (&start, sp->digest, 20); /* 11 chars */
 
-  return sp->hashkey;
+  return hashkey;
+}
+
+/*
+ * the hashkey of the graph last parsed into sp->inchi
+ */
+static const char *
+digest_hashkey (spectral_t *sp, const char *inchi, int size)
+{
+  return digest_key (sp, sp->hashkey,
+                     size > 0 ? inchi_layer_c (sp->inchi) : 0, inchi);
+}
+
+const char *
+spectral_digest (spectral_t *sp, const char *inchi)
+{
+  int size;
+
+  size = spectral_inchi (sp, inchi);
+  if (size < 0)
+    return 0;
+
+  sha1_reset (sp->sha1);
+  
+  /*
+   * first block is topology
+   */
+  digest_spectrum (sp, sp->spectrum, size);
+  return digest_hashkey (sp, inchi, size);
+}
+
+const char *
+spectral_digest_weighted (spectral_t *sp, const char *inchi)
+{
+  int size = spectral_parse (sp, inchi, 1);
+  if (size < 0 || spectral_graph (sp, size, 0, 1) < 0)
+    return 0;
+
+  sha1_reset (sp->sha1);
+  digest_spectrum (sp, sp->spectrum, size);
+  return digest_hashkey (sp, inchi, size);
+}
+
+const char *
+spectral_digest_exact (spectral_t *sp, const char *inchi)
+{
+  int size = spectral_parse (sp, inchi, 0);
+  if (size < 0)
+    return 0;
+
+  sha1_reset (sp->sha1);
+  if (digest_cpoly (sp, size) < 0)
+    return 0;
+  return digest_hashkey (sp, inchi, size);
 }
 
+int
+spectral_spectra (const float *spectra[SPECTRAL_TYPES], int mask,
+                  spectral_t *sp, const char *inchi)
+{
+  int t, size = spectral_parse (sp, inchi, 0);
+  if (size < 0)
+    return -1;
+
+  if (graph_spectra (sp, size, mask) < 0)
+    return -1;
+
+  for (t = 0; t < SPECTRAL_TYPES; ++t)
+    spectra[t] = mask & (1 << t) ? sp->mspectrum[t] : 0;
+  return size;
+}
+
+/*
+ * normalized laplacian spectrum of section k of the graph last parsed
+ * into sp->inchi into sp->cspectrum, in workspace sp->cws[k]; safe to
+ * run for different sections at the same time
+ */
+static int
+section_spectrum (spectral_t *sp, int k)
+{
+  const int *j, *p = inchi_adjacency (sp->inchi, &j);
+  const solver_t *s;
+  solver_ws_t *ws = sp->cws[k];
+  int i, first, n = inchi_section (sp->inchi, k, &first, 0, 0);
+
+  /* the digest precision of an approximate solver is no use here */
+  s = sp->solver != 0 && !sp->solver->approx
+    ? sp->solver : solver_select (&sp->policy, n);
+  solver_ws_reserve (ws, n);
+  normalized_matrix (ws->a, p, j, first, n);
+  if ((*s->solve) (ws, n, 0) < 0)
+    return -1;
+
+  for (i = 0; i < n; ++i)
+    sp->cspectrum[first+i] = spectrum_value (ws->w[i]);
+  return n;
+}
+
+int
+spectral_components (const spectral_component_t **components,
+                     spectral_t *sp, const char *inchi)
+{
+  int i, k, n, first, nv, err = 0, ns = 0, *solve;
+  int nc = inchi_parse_sections (sp->inchi, inchi);
+  const char *c, *ci;
+
+  if (nc < 0)
+    {
+      (void) strcpy (sp->errmsg, inchi_error (sp->inchi));
+      return -1;
+    }
+
+  /* spectral_spectrum and spectral_vector have nothing to go on */
+  sp->size = 0;
+  sp->used = 0;
+
+  if (sp->csize < nc)
+    {
+      sp->component = realloc (sp->component,
+                               nc*sizeof (spectral_component_t));
+      sp->ckey = realloc (sp->ckey, nc*sizeof (sp->hashkey));
+      sp->cws = realloc (sp->cws, nc*sizeof (solver_ws_t *));
+      for (k = sp->csize; k < nc; ++k)
+        sp->cws[k] = 0;
+      sp->csize = nc;
+    }
+
+  /* digest_spectrum looks one past a spectrum without nonzeros */
+  nv = inchi_node_count (sp->inchi);
+  if (sp->cvsize < nv+1)
+    {
+      sp->cspectrum = realloc (sp->cspectrum, (nv+1)*sizeof (float));
+      sp->cvsize = nv+1;
+    }
+  (void) memset (sp->cspectrum, 0, (nv+1)*sizeof (float));
+
+  /* a section with the same connections as one before shares its spectrum */
+  solve = malloc ((nc+1)*sizeof (int));
+  for (k = 0; k < nc; ++k)
+    {
+      spectral_component_t *x = sp->component + k;
+      n = inchi_section (sp->inchi, k, &first, &x->multiplier, &c);
+      if (n > SPECTRAL_MAXG)
+        {
+          sprintf (sp->errmsg, "Graph is too large (%d > %d) for eigensolver",
+                   n, SPECTRAL_MAXG);
+          free (solve);
+          return -1;
+        }
+
+      x->size = n;
+      x->spectrum = sp->cspectrum + first;
+      x->hashkey = sp->ckey + k*sizeof (sp->hashkey);
+      for (i = 0; i < k; ++i)
+        if (inchi_section (sp->inchi, i, 0, 0, &ci) == n
+            && strcmp (c, ci) == 0)
+          break;
+      if (i < k)
+        x->spectrum = sp->component[i].spectrum;
+      else if (n > 0)
+        {
+          if (sp->cws[k] == 0)
+            sp->cws[k] = solver_ws_create ();
+          solve[ns++] = k;
+        }
+    }
+
+#ifdef _OPENMP
+# pragma omp parallel for reduction(|:err) schedule(dynamic) \
+  if (nv >= SPECTRAL_PARALLELG && ns > 1)
+#endif
+  for (i = 0; i < ns; ++i)
+    if (section_spectrum (sp, solve[i]) < 0)
+      err = 1;
+  free (solve);
+
+  if (err)
+    {
+      sprintf (sp->errmsg, "Eigensolver didn't converge within "
+               "specified number of iterations");
+      return -1;
+    }
+
+  for (k = 0; k < nc; ++k)
+    {
+      spectral_component_t *x = sp->component + k;
+      (void) inchi_section (sp->inchi, k, 0, 0, &c);
+      sha1_reset (sp->sha1);
+      digest_spectrum (sp, x->spectrum, x->size);
+      (void) digest_key (sp, sp->ckey + k*sizeof (sp->hashkey),
+                         x->size > 0 ? c : 0, inchi);
+    }
+
+  *components = sp->component;
+  return nc;
+}
+
+/*
+ * tr(S^j), j = 0..k, of S = I - L = D^{-1/2} A D^{-1/2} from walks of
+ * half the length out of every vertex: tr(S^2m) = sum_i |S^m e_i|^2 and
+ * tr(S^2m+1) = sum_i (S^m e_i)' S (S^m e_i). S^m e_i is 0 outside the
+ * vertices within m bonds of i, so each walk only runs over that ball,
+ * grown a breadth first layer at a time: O(k*edges) in all for the
+ * bounded degrees and small k of molecules, rather than O(k*nv*edges).
+ */
+static void
+graph_walks (const spectral_t *sp, int nv, int k, double *t)
+{
+  double *buf = calloc (2*nv, sizeof (double)), *x, *y, *u;
+  int *ball = malloc (2*nv*sizeof (int)), *mark = ball + nv;
+  int i, j, m, q, r, nb, layer;
+
+  for (j = 0; j <= k; ++j)
+    t[j] = 0.;
+  for (j = 0; j < nv; ++j)
+    mark[j] = -1;
+
+  for (i = 0; i < nv; ++i)
+    {
+      x = buf;
+      y = buf + nv;
+      x[i] = 1.;
+      ball[0] = i;
+      mark[i] = i;
+      nb = 1;
+      layer = 0;
+      for (m = 0; 2*m <= k; ++m)
+        {
+          /* the next layer, which S x reaches */
+          for (r = nb; layer < r; ++layer)
+            for (q = sp->sp_p[ball[layer]]; q < sp->sp_p[ball[layer]+1]; ++q)
+              if (mark[sp->sp_j[q]] != i)
+                {
+                  mark[sp->sp_j[q]] = i;
+                  ball[nb++] = sp->sp_j[q];
+                }
+
+          /* x = S^m e_i; y = S x */
+          for (r = 0; r < nb; ++r)
+            {
+              double h = 0.;
+              j = ball[r];
+              for (q = sp->sp_p[j]; q < sp->sp_p[j+1]; ++q)
+                if (sp->sp_j[q] != j)
+                  h -= sp->sp_v[q] * x[sp->sp_j[q]];
+              y[j] = h;
+            }
+
+          for (r = 0; r < nb; ++r)
+            {
+              j = ball[r];
+              t[2*m] += x[j]*x[j];
+              if (2*m+1 <= k)
+                t[2*m+1] += x[j]*y[j];
+            }
+
+          u = x;
+          x = y;
+          y = u;
+        }
+
+      for (r = 0; r < nb; ++r)
+        buf[ball[r]] = buf[nv+ball[r]] = 0.;
+    }
+
+  free (ball);
+  free (buf);
+}
+
+int
+spectral_moments (double *moments, int k, spectral_t *sp, const char *inchi)
+{
+  double *t, c;
+  int i, j, size = spectral_parse (sp, inchi, 0);
+  if (size < 0)
+    return -1;
+
+  if (size == 0 || k < 1)
+    {
+      for (j = 0; j < k; ++j)
+        moments[j] = 0.;
+      return size;
+    }
+
+  (void) graph_sparse (sp, sp->inchi);
+  t = malloc ((k+1)*sizeof (double));
+  graph_walks (sp, size, k, t);
+
+  /* tr(L^j) = tr((I - S)^j) = sum_i C(j,i) (-1)^i tr(S^i) */
+  for (j = 1; j <= k; ++j)
+    {
+      moments[j-1] = 0.;
+      for (i = 0, c = 1.; i <= j; ++i)
+        {
+          moments[j-1] += (i % 2 == 0 ? c : -c) * t[i];
+          c = c * (j-i) / (i+1);
+        }
+      moments[j-1] /= size;
+    }
+  free (t);
+
+  return size;
+}
+
+int
+spectral_stats (spectral_stats_t *stats, spectral_t *sp, const char *inchi)
+{
+  double m[4], var;
+  int size = spectral_moments (m, 4, sp, inchi);
+  if (size < 0)
+    return -1;
+
+  (void) memset (stats, 0, sizeof (*stats));
+  if (size == 0)
+    return 0;
+
+  var = m[1] - m[0]*m[0];
+  stats->sq_power = size * m[1];
+  stats->mean_sq_power = m[1];
+  stats->mean = m[0];
+  stats->var = var;
+  if (var > 0.)
+    {
+      stats->skewness = (m[2] - 3.*m[0]*m[1] + 2.*m[0]*m[0]*m[0])
+        / pow (var, 1.5);
+      stats->kurtosis = (m[3] - 4.*m[0]*m[2] + 6.*m[0]*m[0]*m[1]
+                         - 3.*m[0]*m[0]*m[0]*m[0]) / (var*var) - 3.;
+    }
+
+  return size;
+}
+
+/*
+ * largest over n times the smallest non-zero eigenvalue. only the two
+ * extremes are needed, so graphs larger than SPECTRAL_LANCZOSG run
+ * lanczos on the sparse laplacian with the null space deflated instead
+ * of a full decomposition (and have no spectrum afterwards).
+ */
 int
 spectral_ratio (double *ratio, spectral_t *sp, const char *inchi)
 {
-  int i, size = spectral_inchi (sp, inchi);
+  double lmin, lmax;
+  int nulls, size = spectral_parse (sp, inchi, 0);
   if (size < 0)
     return -1;
 
-  i = 0;
-  /* skip over all disconnected components */
-  while (i < size && sp->spectrum[++i] < EPS)
-    ;
+  if (size <= SPECTRAL_LANCZOSG)
+    {
+      if (spectral_graph (sp, size, 1, 0) < 0)
+        return -1;
+      /* one (numerically) zero eigenvalue per connected component */
+      for (nulls = 0; nulls < size && sp->ws->w[nulls] < NULL_EPS; ++nulls)
+        ;
+      lmin = nulls < size ? sp->ws->w[nulls] : 0.;
+      lmax = size > 0 ? sp->ws->w[size-1] : 0.;
+    }
+  else
+    {
+      nulls = graph_sparse (sp, sp->inchi);
+      if (sp->lz == 0)
+        sp->lz = lanczos_create ();
+      if (nulls < size
+          && lanczos_extremes (sp->lz, size, sp->sp_p, sp->sp_j, sp->sp_v,
+                               sp->comp, sp->null, &lmin, &lmax) < 0)
+        {
+          (void) strcpy (sp->errmsg, "Lanczos didn't converge to the "
+                         "extreme eigenvalues");
+          return -1;
+        }
+    }
 
-#if 0
-  { int j = i;
-    fprintf (stderr, "pi: %.5f\n", sp->spectrum[6]/sp->spectrum[3]);
-    for (; j < size; ++j)
-      {
-        fprintf (stderr, "%3d: %.5f %.5f\n",
-                 j, sp->spectrum[j]/sp->spectrum[i], sp->spectrum[j]);
-      }
-  }
+  if (nulls >= size)
+    {
+      (void) strcpy (sp->errmsg, "Graph has no non-zero eigenvalue");
+      return -1;
+    }
+
+#ifdef SPECTRAL_DEBUG
+  printf ("## ratio: %d vertices, lmin = %.10f, lmax = %.10f\n",
+          size, lmin, lmax);
 #endif
-  
-  *ratio = sp->spectrum[size-1]/(size*sp->spectrum[i]);
+
+  *ratio = lmax/(size*lmin);
   return 0;
 }
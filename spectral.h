@@ -13,15 +13,135 @@ typedef struct __spectral_s spectral_t;
 
 extern spectral_t *spectral_create ();
 extern const char * spectral_digest (spectral_t *, const char *inchi);
+/*
+ * same as spectral_digest, except the first (topology) block hashes the
+ * exact integer coefficients of det(xD - L), whose roots are the
+ * normalized laplacian spectrum, instead of the rounded eigenvalues. no
+ * eigensolver (or floating point) is involved, so it's the same on any
+ * backend or host; the keys are not comparable to spectral_digest's.
+ */
+extern const char * spectral_digest_exact (spectral_t *, const char *inchi);
+/*
+ * same as spectral_digest, but for the weighted normalized laplacian
+ * with each bond weighted by its energy, so that e.g. C-C and C-Cl bonds
+ * count differently; spectral_spectrum (and spectral_vector) are then
+ * those of the weighted laplacian. the keys are not comparable to
+ * spectral_digest's.
+ */
+extern const char * spectral_digest_weighted (spectral_t *,
+                                              const char *inchi);
 extern const char * spectral_hashkey (const spectral_t *);
 extern const char * spectral_error (const spectral_t *);
 extern void spectral_free (spectral_t *);
 extern const char *spectral_version ();
 extern int spectral_ratio (double *ratio, spectral_t *, const char *inchi);
+
+/*
+ * spectral moments of the normalized laplacian L of inchi, i.e.,
+ * moments[j-1] = sum of lambda^j / n = tr(L^j) / n for j = 1..k, computed
+ * from closed walks on the graph instead of an eigensolve. returns the
+ * number of vertices or -1 on error.
+ */
+extern int spectral_moments (double *moments, int k, spectral_t *,
+                             const char *inchi);
+
+/*
+ * eigenvalue statistics of inchi from its first four spectral moments
+ * (the median isn't available that way); kurtosis is excess kurtosis
+ */
+typedef struct __spectral_stats_s {
+  double sq_power; /* sum of lambda^2 */
+  double mean_sq_power;
+  double mean; /* always 1 */
+  double var;
+  double skewness;
+  double kurtosis;
+} spectral_stats_t;
+
+extern int spectral_stats (spectral_stats_t *, spectral_t *,
+                           const char *inchi);
+
+/*
+ * matrix types of spectral_spectra
+ */
+#define SPECTRAL_ADJACENCY  0x1 /* A */
+#define SPECTRAL_LAPLACIAN  0x2 /* D - A */
+#define SPECTRAL_SIGNLESS   0x4 /* D + A */
+#define SPECTRAL_NORMALIZED 0x8 /* I - D^{-1/2} A D^{-1/2} */
+#define SPECTRAL_TYPES 4
+#define SPECTRAL_ALL ((1 << SPECTRAL_TYPES) - 1)
+
+/*
+ * spectra (in ascending order) of each type of matrix in mask of inchi's
+ * graph from a single parse; spectra[i] is that of type 1 << i, or null
+ * if it's not in mask, and is only valid until the next call. returns
+ * the number of vertices or -1 on error. the matrices are solved back to
+ * back, or concurrently if the library is built with OpenMP.
+ */
+extern int spectral_spectra (const float *spectra[SPECTRAL_TYPES], int mask,
+                             spectral_t *, const char *inchi);
+
+/*
+ * a component of a mixture (see spectral_components)
+ */
+typedef struct __spectral_component_s {
+  int multiplier; /* components of the mixture it stands for */
+  int size; /* vertices */
+  const float *spectrum; /* normalized laplacian spectrum, ascending */
+  /*
+   * the topology and connection blocks are the component's own, the last
+   * one is the whole inchi's; the largest component's hashkey is the one
+   * spectral_digest gives
+   */
+  const char *hashkey;
+} spectral_component_t;
+
+/*
+ * every component of inchi from a single parse, in the order of its
+ * connection layer: a section repeated by a multiplier (n*) is a single
+ * component and sections with the same connections are only solved
+ * once. distinct sections of larger mixtures are solved concurrently if
+ * the library is built with OpenMP. *components is only valid until the
+ * next call; returns their number or -1 on error.
+ */
+extern int spectral_components (const spectral_component_t **components,
+                                spectral_t *, const char *inchi);
 extern size_t spectral_size (const spectral_t *);
+/*
+ * eigenvalues of the last graph in ascending order. if it was digested
+ * with an approximate solver (bisect), it's solved again with the
+ * default policy on first request, so this (and the eigenvectors below)
+ * never see digest-precision values; null if that fails.
+ */
 extern const float *spectral_spectrum (const spectral_t *);
+/*
+ * eigenvectors of the last graph are computed lazily, on first request,
+ * so spectral_digest alone only pays for the eigenvalues. the returned
+ * buffer is only valid until the next call to either function. the
+ * sign of an eigenvector is fixed by making its first component of
+ * magnitude SOLVER_ZERO_EPS (1e-10) or more positive; smaller components
+ * (and eigenvalues in any of the spectra) are returned as 0.
+ */
 extern const float *spectral_fiedler (const spectral_t *);
-extern const float *spectral_vector (const spectral_t *, int);
+extern const float *spectral_vector (const spectral_t *, int k);
+
+/*
+ * eigensolver selection; by default the solver is chosen per graph based
+ * on its size. name is one of spectral_solver_name(0..) or "auto" (or 0)
+ * to restore the default policy. the environment variable SPECTRAL_SOLVER
+ * has the same effect at spectral_create time.
+ */
+extern int spectral_set_solver (spectral_t *, const char *name);
+extern const char *spectral_solver (const spectral_t *); /* last used */
+extern const char *spectral_solver_name (int i); /* 0 if out of range */
+
+/*
+ * time the compiled-in solvers on this host and write the fastest solver
+ * for each graph size range to profile (or $SPECTRAL_PROFILE, defaulting
+ * to ~/.spectral_profile, if profile is null); spectral_create picks up
+ * the profile from the same default location. returns 0 on success.
+ */
+extern int spectral_tune (const char *profile, int verbose);
 #ifdef __cplusplus
 }
 #endif
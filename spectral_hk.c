@@ -9,47 +9,6 @@
 #include <math.h>
 #include "spectral.h"
 
-typedef struct eigenstats_s {
-  double sq_power;
-  double mean_sq_power;
-  double mean;
-  double var;
-  double median;
-  double skewness;
-  double kurtosis;
-} eigenstats_t;
-
-/*
- * s is sorted
- */
-static void calc_stats (eigenstats_t *stats, const float *s, size_t len)
-{
-  size_t i;
-  double v;
-  (void) memset (stats, 0, sizeof (*stats));
-  for (i = 0; i < len; ++i)
-    {
-      stats->mean += s[i];
-      stats->sq_power += s[i]* s[i];
-    }
-  stats->mean /= len; /* always 1 for normalized laplacian */
-  stats->mean_sq_power = stats->sq_power / len;
-  if (len % 2 == 0)
-    stats->median = (s[len/2-1] + s[len/2])/2.;
-  else
-    stats->median = s[len/2];
-  /* second pass */
-  for (i = 0; i < len; ++i)
-    {
-      v = s[i] - stats->mean;
-      stats->var += v * v;
-      stats->skewness += v*v*v;
-    }
-  v = stats->skewness;
-  stats->skewness = (v/len) / pow(stats->var/(len-1.0), 1.5);
-  stats->var /= len;
-}
-
 int
 main (int argc, char *argv[])
 {
@@ -60,8 +19,62 @@ main (int argc, char *argv[])
   char inchi[1<<14] = {0};
   char *end = buffer + sizeof (buffer);
   const char *hk;
+  int stats = 0, exact = 0, spectra = 0, weighted = 0, components = 0;
 
   fprintf (stderr, "## spectral_hk -- %s\n", spectral_version ());
+  if (argc > 1 && strcmp (argv[1], "--tune") == 0)
+    {
+      /* spectral_hk --tune [profile] */
+      int err = spectral_tune (argc > 2 ? argv[2] : 0, 1);
+      if (err < 0)
+        fprintf (stderr, "** error: tuning failed or profile can't be "
+                 "written! **\n");
+      spectral_free (spectral);
+      return err < 0 ? 1 : 0;
+    }
+
+  if (argc > 1 && strcmp (argv[1], "--stats") == 0)
+    {
+      /* spectral_hk --stats [in [out]]; eigenvalue statistics only */
+      stats = 1;
+      --argc;
+      ++argv;
+    }
+  else if (argc > 1 && strcmp (argv[1], "--exact") == 0)
+    {
+      /* spectral_hk --exact [in [out]]; characteristic polynomial keys */
+      exact = 1;
+      --argc;
+      ++argv;
+    }
+  else if (argc > 1 && strcmp (argv[1], "--weighted") == 0)
+    {
+      /* spectral_hk --weighted [in [out]]; bond weighted laplacian keys */
+      weighted = 1;
+      --argc;
+      ++argv;
+    }
+  else if (argc > 1 && strcmp (argv[1], "--spectra") == 0)
+    {
+      /*
+       * spectral_hk --spectra [in [out]]; adjacency, laplacian, signless
+       * and normalized laplacian spectra, one column each
+       */
+      spectra = 1;
+      --argc;
+      ++argv;
+    }
+  else if (argc > 1 && strcmp (argv[1], "--components") == 0)
+    {
+      /*
+       * spectral_hk --components [in [out]]; a line per component with
+       * its hashkey, index, multiplier, size and spectrum
+       */
+      components = 1;
+      --argc;
+      ++argv;
+    }
+
   if (argc > 1)
     {
       infp = fopen (argv[1], "r");
@@ -102,13 +115,83 @@ main (int argc, char *argv[])
           (void) strncpy (inchi, buffer, tok - buffer);
           inchi[tok-buffer] = '\0';
 
-          hk = spectral_digest (spectral, inchi);
+          if (stats)
+            {
+              spectral_stats_t st;
+              int size = spectral_stats (&st, spectral, inchi);
+              if (size >= 0)
+                (void) fprintf (outfp, "%s\t%d\t%.5f,%.5f,%.5f,%.5f,%.5e,"
+                                "%.5e\n", inchi, size, st.sq_power,
+                                st.mean_sq_power, st.mean, st.var,
+                                st.skewness, st.kurtosis);
+              else
+                (void) fprintf (stderr, "error: ** failed to process %s "
+                                "(%s) **\n", inchi, spectral_error (spectral));
+              continue;
+            }
+
+          if (spectra)
+            {
+              const float *v[SPECTRAL_TYPES];
+              int i, t, size = spectral_spectra (v, SPECTRAL_ALL, spectral,
+                                                 inchi);
+              if (size < 0)
+                {
+                  (void) fprintf (stderr, "error: ** failed to process %s "
+                                  "(%s) **\n", inchi,
+                                  spectral_error (spectral));
+                  continue;
+                }
+
+              (void) fprintf (outfp, "%s\t%d", inchi, size);
+              for (t = 0; t < SPECTRAL_TYPES; ++t)
+                {
+                  (void) fprintf (outfp, "\t");
+                  for (i = 0; i < size; ++i)
+                    (void) fprintf (outfp, i > 0 ? ",%.5f" : "%.5f", v[t][i]);
+                }
+              (void) fprintf (outfp, "\n");
+              continue;
+            }
+
+          if (components)
+            {
+              const spectral_component_t *c;
+              int i, k, n = spectral_components (&c, spectral, inchi);
+              if (n < 0)
+                (void) fprintf (stderr, "error: ** failed to process %s "
+                                "(%s) **\n", inchi,
+                                spectral_error (spectral));
+              for (k = 0; k < n; ++k)
+                {
+                  (void) fprintf (outfp, "%s\t%s\t%d\t%d\t%d\t", c[k].hashkey,
+                                  inchi, k, c[k].multiplier, c[k].size);
+                  for (i = 0; i < c[k].size; ++i)
+                    (void) fprintf (outfp, i > 0 ? ",%.5f" : "%.5f",
+                                    c[k].spectrum[i]);
+                  (void) fprintf (outfp, "\n");
+                }
+              continue;
+            }
+
+          if (exact)
+            hk = spectral_digest_exact (spectral, inchi);
+          else if (weighted)
+            hk = spectral_digest_weighted (spectral, inchi);
+          else
+            hk = spectral_digest (spectral, inchi);
           if (hk != 0)
             {
               tok = buffer + strlen (buffer);
               while (--tok > buffer && *tok != '\n')
                 ;
               *tok = '\0';
+
+              if (exact)
+                {
+                  (void) fprintf (outfp, "%s\t%s\n", hk, buffer);
+                  continue;
+                }
                     
               { size_t i, size = spectral_size (spectral);
                 const float *v = spectral_spectrum (spectral);
@@ -130,18 +213,6 @@ main (int argc, char *argv[])
                     if (i+1 < size)
                       (void) fprintf (outfp, ",");
                   }
-#endif
-#if 0                
-                (void) fprintf (outfp, "\t");           
-                { eigenstats_t stats;
-                  calc_stats (&stats, spectral_spectrum (spectral), size);
-                  (void) fprintf (outfp, "%.5f,", stats.sq_power);
-                  (void) fprintf (outfp, "%.5f,", stats.mean_sq_power);
-                  (void) fprintf (outfp, "%.5f,", stats.mean);
-                  (void) fprintf (outfp, "%.5f,", stats.var);
-                  (void) fprintf (outfp, "%.5f,", stats.median);
-                  (void) fprintf (outfp, "%.5e", stats.skewness);
-                }
 #endif
                 (void) fprintf (outfp, "\n");
               }
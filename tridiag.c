@@ -0,0 +1,403 @@
+
+#include <math.h>
+#include <float.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "tridiag.h"
+
+#ifndef MAX_ITER
+# define MAX_ITER 60
+#endif
+
+#define __A(i,j) a[(i)*n+(j)]
+
+/**
+ * tred2 from the book Numerical Recipes in C, 1992
+ */
+void
+tridiag_reduce (double *a, int n, double d[], double e[], int vectors,
+                double tau[])
+{
+  int l, k, j, i;
+  double scale, hh, h, g, f;
+
+  for (i = n-1; i > 0; --i)
+    {
+      l = i-1;
+      h = scale = 0.;
+      if (l > 0)
+        {
+          for (k = 0; k <= l; ++k)
+            scale += fabs (__A(i,k));
+
+          if (scale == 0.)
+            e[i] = __A(i,l);
+          else
+            {
+              for (k = 0; k <= l; ++k)
+                {
+                  __A(i,k) /= scale;
+                  h += __A(i,k) * __A(i,k);
+                }
+              f = __A(i,l);
+              g = f >= 0. ? -sqrt (h) : sqrt (h);
+              e[i] = scale*g;
+              h -= f*g;
+              __A(i,l) = f-g;
+              f = 0.;
+              for (j = 0; j <= l; ++j)
+                {
+                  if (vectors)
+                    __A(j,i) = __A(i,j)/h;
+                  g = 0.;
+                  for (k = 0; k <= j; ++k)
+                    g += __A(j,k) * __A(i,k);
+                  for (k = j+1; k <= l; ++k)
+                    g += __A(k,j) * __A(i,k);
+                  e[j] = g/h;
+                  f += e[j] * __A(i,j);
+                }
+              hh = f/(h+h);
+              for (j = 0; j <= l; ++j)
+                {
+                  f = __A(i,j);
+                  e[j] = g = e[j] - hh*f;
+                  for (k = 0; k <= j; ++k)
+                    __A(j,k) -= f*e[k] + g*__A(i,k);
+                }
+            }
+        }
+      else
+        e[i] = __A(i,l);
+      d[i] = h;
+    }
+
+  d[0] = 0.;
+  e[0] = 0.;
+  if (tau != 0)
+    for (i = 0; i < n; ++i)
+      tau[i] = d[i];
+
+  for (i = 0; i < n; ++i)
+    {
+      if (vectors)
+        {
+          l = i-1;
+          if (d[i] != 0.)
+            {
+              for (j = 0; j <= l; ++j)
+                {
+                  g = 0.;
+                  for (k = 0; k <= l; ++k)
+                    g += __A(i,k) * __A(k,j);
+                  for (k = 0; k <= l; ++k)
+                    __A(k,j) -= g * __A(k,i);
+                }
+            }
+          d[i] = __A(i,i);
+          __A(i,i) = 1.;
+          for (j = 0; j <= l; ++j)
+            __A(j,i) = __A(i,j) = 0.;
+        }
+      else
+        d[i] = __A(i,i);
+    }
+}
+
+/*
+ * x := Q x, where Q = P[n-1]...P[1] and P[i] = I - u u'/tau[i] with u
+ * in row i of a (left there by tridiag_reduce)
+ */
+void
+tridiag_apply (const double *a, const double tau[], int n, double x[])
+{
+  int i, k;
+  double g;
+
+  for (i = 1; i < n; ++i)
+    if (tau[i] != 0.)
+      {
+        g = 0.;
+        for (k = 0; k < i; ++k)
+          g += __A(i,k) * x[k];
+        g /= tau[i];
+        for (k = 0; k < i; ++k)
+          x[k] -= g * __A(i,k);
+      }
+}
+
+#undef __A
+
+/*
+ * inverse iteration with partial pivoting (after LAPACK's dlagtf/dlagts
+ * and dstein); the shift is the computed eigenvalue itself, so a pivot
+ * that vanishes is replaced by a tiny multiple of the matrix norm
+ */
+int
+tridiag_vector (const double d[], const double e[], int n, double lambda,
+                double x[], double *work)
+{
+  double *a = work, *b = work + n, *c = work + 2*n, *f = work + 3*n;
+  double *p = work + 4*n; /* row k and k+1 were swapped if p[k] != 0 */
+  double norm = 0., tiny, t, mult;
+  unsigned int seed = 1;
+  int i, k, iter;
+
+  if (n == 1)
+    {
+      x[0] = 1.;
+      return 0;
+    }
+
+  for (i = 0; i < n; ++i)
+    {
+      a[i] = d[i] - lambda;
+      t = fabs (d[i]) + (i > 0 ? fabs (e[i]) : 0.)
+        + (i+1 < n ? fabs (e[i+1]) : 0.);
+      if (t > norm)
+        norm = t;
+    }
+  for (i = 0; i < n-1; ++i)
+    b[i] = c[i] = e[i+1];
+  tiny = DBL_EPSILON * (norm > 0. ? norm : 1.);
+
+  /* LU factorization of T - lambda I; U has two superdiagonals (b, f) */
+  for (k = 0; k < n-1; ++k)
+    {
+      f[k] = 0.;
+      if (fabs (a[k]) >= fabs (c[k]))
+        {
+          p[k] = 0.;
+          mult = a[k] != 0. ? c[k]/a[k] : 0.;
+          a[k+1] -= mult*b[k];
+        }
+      else
+        {
+          p[k] = 1.;
+          mult = a[k]/c[k];
+          a[k] = c[k];
+          t = a[k+1];
+          a[k+1] = b[k] - mult*t;
+          if (k < n-2)
+            {
+              f[k] = b[k+1];
+              b[k+1] = -mult*f[k];
+            }
+          b[k] = t;
+        }
+      c[k] = mult;
+    }
+
+  for (k = 0; k < n; ++k)
+    if (fabs (a[k]) < tiny)
+      a[k] = a[k] >= 0. ? tiny : -tiny;
+
+  /* pseudo random start, so it's reproducible */
+  for (i = 0; i < n; ++i)
+    {
+      seed = seed*1103515245u + 12345u;
+      x[i] = ((seed >> 16) & 0x7fff)/16384. - 1.;
+    }
+
+  for (iter = 0; iter < 3; ++iter)
+    {
+      /* the first iteration solves U x = b as dstein does */
+      if (iter > 0)
+        for (k = 0; k < n-1; ++k)
+          {
+            if (p[k] != 0.)
+              {
+                t = x[k];
+                x[k] = x[k+1];
+                x[k+1] = t - c[k]*x[k];
+              }
+            else
+              x[k+1] -= c[k]*x[k];
+          }
+
+      x[n-1] /= a[n-1];
+      x[n-2] = (x[n-2] - b[n-2]*x[n-1])/a[n-2];
+      for (k = n-3; k >= 0; --k)
+        x[k] = (x[k] - b[k]*x[k+1] - f[k]*x[k+2])/a[k];
+
+      t = 0.;
+      for (i = 0; i < n; ++i)
+        t += x[i]*x[i];
+      if (!(t > 0.) || isinf (t))
+        return -1;
+      t = 1./sqrt (t);
+      for (i = 0; i < n; ++i)
+        x[i] *= t;
+    }
+
+  return 0;
+}
+
+/*
+ * sqrt (a*a + b*b) unless that could over- or underflow; the libm hypot
+ * takes care to round exactly, which makes it the bulk of tridiag_ql for
+ * the matrices of molecules
+ */
+static inline double
+pythag (double a, double b)
+{
+  double x = fabs (a) > fabs (b) ? fabs (a) : fabs (b);
+  if (x < 0x1p-500 || x > 0x1p500)
+    return hypot (a, b);
+  return sqrt (a*a + b*b);
+}
+
+/**
+ * tqli from the book Numerical Recipes in C, 1992
+ */
+int
+tridiag_ql (double d[], double e[], int n, double *z)
+{
+  int m, l, iter, i, k;
+  double s, r, p, g, f, dd, c, b;
+
+  for (i = 1; i < n; ++i)
+    e[i-1] = e[i];
+  if (n > 0)
+    e[n-1] = 0.;
+
+  for (l = 0; l < n; ++l)
+    {
+      iter = 0;
+      do
+        {
+          for (m = l; m < n-1; ++m)
+            {
+              dd = fabs (d[m]) + fabs (d[m+1]);
+              if (fabs (e[m]) <= DBL_EPSILON*dd)
+                break;
+            }
+
+          if (m != l)
+            {
+              if (iter++ == MAX_ITER)
+                return -1;
+
+              g = (d[l+1]-d[l])/(2.*e[l]);
+              r = pythag (g, 1.);
+              g = d[m]-d[l]+e[l]/(g + (g >= 0. ? fabs (r) : -fabs (r)));
+              s = c = 1.;
+              p = 0.;
+              for (i = m-1; i >= l; --i)
+                {
+                  f = s*e[i];
+                  b = c*e[i];
+                  e[i+1] = (r = pythag (f, g));
+                  if (r == 0.)
+                    {
+                      d[i+1] -= p;
+                      e[m] = 0.;
+                      break;
+                    }
+                  s = f/r;
+                  c = g/r;
+                  g = d[i+1]-p;
+                  r = (d[i]-g)*s + 2.*c*b;
+                  d[i+1] = g + (p = s*r);
+                  g = c*r-b;
+                  if (z != 0)
+                    {
+                      /* rows i and i+1 are contiguous */
+                      double *zi = z + i*n, *zj = zi + n;
+                      for (k = 0; k < n; ++k)
+                        {
+                          f = zj[k];
+                          zj[k] = s*zi[k] + c*f;
+                          zi[k] = c*zi[k] - s*f;
+                        }
+                    }
+                }
+              if (r == 0. && i >= l)
+                continue;
+              d[l] -= p;
+              e[l] = g;
+              e[m] = 0.;
+            }
+        }
+      while (m != l);
+    }
+
+  return 0;
+}
+
+void
+tridiag_sort (double d[], double *z, int n)
+{
+  int i, j, k;
+  double p;
+
+  for (i = 0; i < n-1; ++i)
+    {
+      p = d[k = i];
+      for (j = i+1; j < n; ++j)
+        if (d[j] < p)
+          p = d[k = j];
+
+      if (k != i)
+        {
+          d[k] = d[i];
+          d[i] = p;
+          if (z != 0)
+            {
+              double *zi = z + i*n, *zk = z + k*n;
+              for (j = 0; j < n; ++j)
+                {
+                  p = zi[j];
+                  zi[j] = zk[j];
+                  zk[j] = p;
+                }
+            }
+        }
+    }
+}
+
+
+#ifdef __TRIDIAG_TEST
+int main ()
+{
+  /* laplacian of the path graph P6 */
+  enum { n = 6 };
+  double a[n*n] = {
+     1, -1,  0,  0,  0,  0,
+    -1,  2, -1,  0,  0,  0,
+     0, -1,  2, -1,  0,  0,
+     0,  0, -1,  2, -1,  0,
+     0,  0,  0, -1,  2, -1,
+     0,  0,  0,  0, -1,  1
+  };
+  double d[n], e[n], z[n*n];
+  int i, j, err;
+
+  tridiag_reduce (a, n, d, e, 1, 0);
+  for (i = 0; i < n; ++i)
+    for (j = 0; j < n; ++j)
+      z[i*n+j] = a[j*n+i]; /* transpose */
+
+  err = tridiag_ql (d, e, n, z);
+  if (err == 0)
+    {
+      tridiag_sort (d, z, n);
+      /* expected: 2 - 2cos(k pi/6), k = 0..5 */
+      printf ("Eigenvalues & Fiedler vector\n");
+      for (i = 0; i < n; ++i)
+        printf ("%10.4f %10.4f %10.4f\n", d[i], 2.-2.*cos (i*M_PI/n), z[n+i]);
+    }
+  else
+    printf ("error: tqli didn't converge!\n");
+
+  return err;
+}
+#endif
+
+/**
+ * Local Variables:
+ * compile-command: "gcc -Wall -g -o tridiag tridiag.c -D__TRIDIAG_TEST -lm"
+ * End:
+ */
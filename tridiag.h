@@ -0,0 +1,60 @@
+
+#ifndef __tridiag_h__
+#define __tridiag_h__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Householder reduction of a real symmetric matrix to tridiagonal form
+ * followed by implicit QL; like jacobi.c this follows the book Numerical
+ * Recipes in C, but operates on a contiguous, row major n x n matrix.
+ */
+
+/*
+ * reduce the symmetric matrix a (only the lower triangle is referenced)
+ * to tridiagonal form; on return d[0..n-1] is the diagonal and
+ * e[1..n-1] the subdiagonal (e[0] = 0). if vectors is nonzero, a is
+ * replaced by the orthogonal matrix Q effecting the transformation.
+ * otherwise, if tau is not null, the Householder vectors are left in the
+ * lower triangle of a and their scalars in tau[0..n-1] for tridiag_apply
+ */
+extern void tridiag_reduce (double *a, int n, double d[], double e[],
+                            int vectors, double tau[]);
+
+/*
+ * x := Q x using the reflectors kept by tridiag_reduce (vectors = 0);
+ * turns an eigenvector of the tridiagonal matrix into one of a
+ */
+extern void tridiag_apply (const double *a, const double tau[], int n,
+                           double x[]);
+
+/*
+ * eigenvector x of the tridiagonal matrix d, e (as returned by
+ * tridiag_reduce) for the eigenvalue lambda by inverse iteration; work
+ * must hold 5*n doubles. returns 0 on success or -1 on failure.
+ */
+extern int tridiag_vector (const double d[], const double e[], int n,
+                           double lambda, double x[], double *work);
+
+/*
+ * eigenvalues (and optionally eigenvectors) of the tridiagonal matrix
+ * given by d and e (as returned by tridiag_reduce) using implicit QL;
+ * on return d holds the eigenvalues and e is destroyed. if z is not
+ * null, each ROW i of z is rotated alongside, so z should be initialized
+ * to the transpose of Q (or identity) to obtain the eigenvectors as rows.
+ * returns 0 on success or -1 if it fails to converge.
+ */
+extern int tridiag_ql (double d[], double e[], int n, double *z);
+
+/*
+ * sort the eigenvalues in ascending order; the rows of z (if not null)
+ * are permuted alongside
+ */
+extern void tridiag_sort (double d[], double *z, int n);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* __tridiag_h__ */